@@ -5,7 +5,14 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #define SCREEN_WIDTH 600
 #define SCREEN_HEIGHT 400
@@ -59,6 +66,13 @@ DifficultyLevel selectedDifficulty = DIFFICULTY_MEDIUM;
 int currentLevel = 1;
 int lives = 3;
 
+// Level sequence. With --levels the game plays through a list of binary
+// level files, otherwise through PROCEDURAL_LEVELS generated layouts.
+#define PROCEDURAL_LEVELS 8
+char **levelFiles = NULL;
+Uint32 *levelFileHashes = NULL; // Content hash of each file, for recordings
+int levelFileCount = 0;
+
 // Player variables
 float player_X = SCREEN_WIDTH / 2 - 20;
 float player_Y = SCREEN_HEIGHT - (20 * 3);
@@ -68,22 +82,79 @@ float player_vx = 0;
 int paddleWidth = 90; // Default paddle width
 bool useMouse = false; // Option to use mouse control
 
-// Ball variables
-float ball_x = SCREEN_WIDTH / 2 - 10;
-float ball_y = SCREEN_HEIGHT / 2 - 10;
+// Ball variables, the balls themselves are in the ball system below
 const float normalBallSpeed = 5.0;
 float ballSpeed = 5.0;
-float ball_vx = 0.0;  // Will be set in resetGame()
-float ball_vy = 0.0;  // Will be set in resetGame()
-bool ballLaunched = false;
+bool ballLaunched = false; // Until launch the only ball sits on the paddle
 
 // Game variables
 int totalBall = 35;
 int score = 0;
 bool game_start = false;
 bool automatic_paddle = false;
+float autoPaddleOffset = 0; // Where under the ball the auto paddle aims
+bool varyAutoAim = false;   // Headless bot: aim somewhere new after each hit
 bool paused = false;
 
+// Game random number generator (xorshift32). Gameplay draws from this
+// instead of rand() so a game can be reproduced from its seed.
+Uint32 gameRandomState = 1;
+Uint32 gameSeed = 1; // Seed the current game was started with
+
+// Player input for one simulation tick. Held keys stay set for as long as
+// they are down, presses are only set on the first tick after the key event.
+// Pause isn't part of it: a paused game runs no ticks at all.
+#define INPUT_LEFT         0x01 // a held
+#define INPUT_RIGHT        0x02 // d held
+#define INPUT_LAUNCH       0x04 // space pressed
+#define INPUT_TOGGLE_AUTO  0x08 // f pressed
+#define INPUT_TOGGLE_MOUSE 0x10 // m pressed
+#define INPUT_HELD_MASK    (INPUT_LEFT | INPUT_RIGHT)
+
+typedef struct {
+  Uint8 buttons;
+  Sint16 mouseX;
+} TickInput;
+
+TickInput pendingInput = {0}; // Gathered from events until the next tick
+
+// Input recording and replay. A recording is a small header followed by
+// run-length encoded tick inputs, 5 bytes per run (see writeInputRun()).
+// The header holds everything the simulation depends on besides input:
+//   "BRPL", version, difficulty, tick rate (Uint16), seed (Uint32),
+//   ball substeps, auto paddle aim varies (0 or 1),
+//   level file count (Uint16, 0 for generated levels), level list hash
+//   (Uint32), then the content hash of each level file (Uint32 each)
+// Numbers are little endian.
+#define RECORDING_MAGIC "BRPL"
+#define RECORDING_VERSION 3
+#define RECORDING_HEADER_SIZE 20 // Up to the level file hashes
+
+FILE *recordFile = NULL;
+const char *recordPath = NULL;
+TickInput recordLast = {0};
+int recordRun = 0;
+
+Uint8 *replayData = NULL; // Whole replay file, decoded as it plays
+long replaySize = 0;
+long replayPos = 0;
+int replayRunLeft = 0;
+TickInput replayInput = {0};
+bool replaying = false;
+int replayTicks = 0;
+double replaySpeed = 1.0; // Ticks per real tick while replaying
+
+// Simulation timing. Gameplay speeds are tuned in pixels per 60 Hz frame and
+// scaled by tickScale, so the game plays the same at any tick rate.
+#define MAX_TICK_RATE 1000
+int tickRate = 60;        // Fixed simulation ticks per second
+float tickScale = 1.0f;   // 60 / tickRate
+int targetFps = 60;       // Render frame cap, 0 for uncapped
+
+// Positions at the start of the current tick, rendering blends from these
+// toward the current positions
+float prevPlayer_X = SCREEN_WIDTH / 2 - 20;
+
 // Rectangle structure (moved up before PowerUp)
 typedef struct {
   int x, y, w, h;
@@ -105,13 +176,26 @@ typedef struct PowerUp {
     PowerUpType type;
     Rectangle rect;
     bool active;
-    int duration; // Frames remaining for active effects
+    int duration; // Ticks remaining for active effects
+    float fallY;  // Exact falling position, rect.y is the rounded copy
     struct PowerUp* next;
 } PowerUp;
 
 PowerUp* activePowerUps = NULL;
 PowerUp* fallingPowerUps = NULL;
 
+// Both lists are backed by a fixed pool, free entries are chained through
+// next. Nothing is allocated on the heap while a level runs; when the pool
+// is used up a new drop is simply not spawned.
+#define MAX_POWER_UPS 256
+
+PowerUp powerUpPool[MAX_POWER_UPS];
+PowerUp* freePowerUps = NULL;
+int powerUpsInUse = 0;
+int powerUpsPeak = 0;    // Most entries in use at once since startup
+int powerUpsRefused = 0; // Allocations turned down because the pool was full
+bool showPoolStats = false;
+
 // Sound variables
 Mix_Chunk* sounds[MAX_SOUNDS];
 bool sound_enabled = false; // Flag to track if sound is available
@@ -137,47 +221,285 @@ const char* sound_files[MAX_SOUNDS] = {
     "sounds/menu_click.wav"
 };
 
+// Sound effects are mixed by the game itself rather than on SDL_mixer's
+// channels. The game thread only pushes play events into a lock-free
+// single-producer single-consumer ring; the mixer's post-mix callback on the
+// audio thread drains it and mixes the voices into the output buffer.
+#define SFX_QUEUE_SIZE 256 // Power of two
+#define MAX_VOICES 16
+#define MIX_BLOCK 512 // Samples mixed per pass of the callback
+
+typedef struct {
+  Uint8 sound;
+  Uint64 pushedAt; // Performance counter when the game asked for it
+} SfxEvent;
+
+typedef struct {
+  SfxEvent events[SFX_QUEUE_SIZE];
+  SDL_atomic_t head; // Next slot to write, only the game thread moves it
+  SDL_atomic_t tail; // Next slot to read, only the audio thread moves it
+} SfxQueue;
+
+// A sound effect being played, positions count interleaved samples
+typedef struct {
+  int sound;
+  Uint32 position;
+  Uint32 length;
+} Voice;
+
+// How many copies of each sound may play at once. Past the limit the copy
+// furthest along is restarted instead of stacking another one on top.
+const Uint8 soundVoiceLimit[MAX_SOUNDS] = {
+    [SOUND_PADDLE_HIT] = 2,     [SOUND_BLOCK_HIT] = 4,
+    [SOUND_POWER_UP] = 2,       [SOUND_LEVEL_COMPLETE] = 1,
+    [SOUND_GAME_OVER] = 1,      [SOUND_MENU_SELECT] = 1,
+    [SOUND_MENU_CLICK] = 1};
+
+// Counters for --audio-stats. The game thread owns the first two, the
+// audio thread the rest; they are only read once audio is closed.
+typedef struct {
+  int coalesced;      // Repeats of a sound within one frame, not queued
+  int dropped;        // Events lost to a full queue
+  int played;         // Voices started
+  int stolen;         // Voices cut short for a new one
+  int peakVoices;
+  Uint64 callbacks;
+  Uint64 callbackTicks; // Performance counter ticks spent in the callback
+  Uint64 maxCallbackTicks;
+  Uint64 latencyTicks; // Event push to the start of its mix, summed
+  Uint64 maxLatencyTicks;
+} AudioStats;
+
+SfxQueue sfxQueue = {0};
+Voice voices[MAX_VOICES];
+int voiceCount = 0;
+AudioStats audioStats = {0};
+bool showAudioStats = false;
+bool customMixer = false;    // Off when the device format isn't 16-bit stereo
+int audioBufferSize = 512;   // Sample frames per device buffer, --audio-buffer
+int audioFrequency = 44100;  // What the device actually opened with
+bool audioInitialized = false; // SDL_INIT_AUDIO succeeded on the main thread
+Uint32 soundsThisFrame = 0;  // Bit per sound already queued this frame
+
+// Push a play event stamped with the given time. A sound that was already
+// queued this frame is coalesced into the earlier event.
+void queueSound(int sound, Uint64 now) {
+  if (soundsThisFrame & (1u << sound)) {
+    audioStats.coalesced++;
+    return;
+  }
+  soundsThisFrame |= 1u << sound;
+
+  int head = SDL_AtomicGet(&sfxQueue.head);
+  if (head - SDL_AtomicGet(&sfxQueue.tail) == SFX_QUEUE_SIZE) {
+    audioStats.dropped++;
+    return;
+  }
+  sfxQueue.events[head & (SFX_QUEUE_SIZE - 1)] = (SfxEvent){(Uint8)sound, now};
+  SDL_AtomicSet(&sfxQueue.head, head + 1); // Publishes the event
+}
+
+// Play a sound effect, from the game thread
+void playSound(int sound) {
+  if (!sound_enabled || sounds[sound] == NULL) {
+    return;
+  }
+  if (!customMixer) {
+    Mix_PlayChannel(-1, sounds[sound], 0);
+    return;
+  }
+  queueSound(sound, SDL_GetPerformanceCounter());
+}
+
+// Start a new frame for sound coalescing
+void beginSoundFrame() {
+  soundsThisFrame = 0;
+}
+
 // Rectangle and Arc structures moved up before PowerUp structure
 
-typedef struct BlockNode {
-  Rectangle block;
-  int health;        // Block health - how many hits it takes to destroy
-  int scoreValue;    // Score value when destroyed
-  bool dropsPowerUp; // Whether this block drops a power-up when destroyed
-  PowerUpType powerUpType; // Type of power-up to drop
-  struct BlockNode *next;
-} BlockNode;
+// Blocks of the current level, stored as parallel arrays that share one
+// allocation made when the level is laid out. Destroyed blocks are cleared
+// from the live bitmask instead of being moved, so block indices stay stable
+// for the whole level.
+typedef struct {
+  int count;    // Blocks laid out for this level, live or destroyed
+  int capacity; // Blocks the current allocation can hold
+  int *x, *y, *w, *h;
+  int *health;              // How many hits it takes to destroy
+  int *scoreValue;     // Score value when destroyed
+  SDL_Color *color;
+  Uint8 *powerUpType;  // Type of power-up to drop, a PowerUpType
+  Uint8 *dropsPowerUp; // Whether this block drops a power-up when destroyed
+  Uint64 *liveMask;   // One bit per block, set while it is still standing
+  void *memory;       // Single allocation backing all of the arrays
+} BlockStore;
+
+BlockStore blocks = {0};
+
+// Broad-phase uniform grid over the block layout. Every block is bucketed
+// into each cell it overlaps, so a collision query only looks at the cells
+// under the ball instead of every block.
+#define GRID_CELL_SIZE 64
+
+typedef struct {
+  int originX, originY; // World position of cell (0, 0)
+  int cols, rows;
+  int *cellStart; // First slot of each cell in cellItems
+  int *cellCount; // Live blocks in each cell
+  int *cellItems; // Block indices bucketed by cell, packed per cell
+} BlockGrid;
+
+BlockGrid blockGrid = {0};
+
+// Every ball in play, stored as parallel arrays in one allocation so the
+// per-tick loops run over contiguous floats. Lost balls are swap-removed,
+// ball indices are only stable within a tick.
+#define MAX_BALLS 1024
+#define BALL_RADIUS 10
+
+// Swept ball collision, see sweepBall()
+#define MAX_BALL_CONTACTS 16        // Contact steps per ball per sweep
+#define MAX_SIMULTANEOUS_CONTACTS 8 // Contacts resolved at one instant
+#define CONTACT_EPSILON 1e-4f       // Contacts this close in time are tied
+
+typedef struct {
+  int count;
+  int capacity;
+  float *x, *y;         // Center position
+  float *vx, *vy;       // Pixels per 60 Hz frame
+  float *prevX, *prevY; // Position at the start of the tick
+  void *memory;         // Single allocation backing all of the arrays
+} BallSystem;
+
+BallSystem balls = {0};
+int ballSubsteps = 1; // Sweeps per tick, part of a recording's header
+long long ballContacts = 0; // Contacts resolved by sweepBall(), for stats
+
+// Particles for hit effects, a fixed pool laid out the same way as the
+// balls. Purely visual: they use their own random numbers so replays and
+// headless runs play out the same with or without them.
+#define MAX_PARTICLES 131072
+#define PARTICLES_PER_EFFECT 16
+#define PARTICLE_LIFETIME 40.0f // Longest life, in 60 Hz frames
+#define PARTICLE_GRAVITY 0.15f  // Pixels per frame, added each frame
+#define PARTICLE_SIZE 3
+
+typedef struct {
+  int count;
+  int capacity;
+  int peak;             // Most particles alive at once since startup
+  int refused;          // Particles not emitted because the pool was full
+  float *x, *y;         // Position
+  float *vx, *vy;       // Pixels per 60 Hz frame
+  float *life;          // Frames left to live
+  SDL_Color *color;
+  void *memory;         // Single allocation backing all of the arrays
+} ParticleSystem;
+
+ParticleSystem particles = {0};
+Uint32 particleRandomState = 1;
+
+// Ball sprites, rasterized once per distinct radius, color and arc span
+#define MAX_BALL_SPRITES 16
+
+typedef struct {
+  SDL_Texture *texture;
+  int r;
+  double startAngle;
+  double endAngle;
+  SDL_Color color;
+} BallSprite;
+
+BallSprite ballSprites[MAX_BALL_SPRITES];
+int nextBallSprite = 0; // Next entry to replace once the cache is full
+int ballDrawCalls = 0;  // Render calls issued to draw balls
+
+// Rectangles queued for the frame as vertex colored quads, so any mix of
+// colors goes out in a single SDL_RenderGeometry call from flushRects().
+// The buffers only ever grow and are reused from frame to frame.
+typedef struct {
+  SDL_Vertex *vertices; // Four per rectangle
+  int *indices;         // Six per rectangle, filled in when the buffers grow
+  int count;            // Rectangles queued since the last flush
+  int capacity;         // Rectangles the buffers can hold
+} RectBatch;
+
+RectBatch rectBatch = {0};
+int drawCalls = 0;          // Render submissions, reset every frame
+bool showDrawStats = false; // Draw call count in the HUD and on stdout
 
 // Function prototypes
 void drawRectangle(SDL_Renderer *renderer, Rectangle rectangle);
+void queueRect(Rectangle rectangle);
+int addBall(float x, float y, float vx, float vy);
+void setBallSpeed(float speed);
+void createCollisionEffect(int x, int y, SDL_Color color);
 
 double degreesToRadians(double degrees) { return degrees * M_PI / 180.0; }
 
+// Seed the game random number generator
+void seedGameRandom(Uint32 seed) {
+  // Scramble the seed so neighbouring seeds give unrelated games
+  seed ^= seed >> 16;
+  seed *= 0x7feb352d;
+  seed ^= seed >> 15;
+  seed *= 0x846ca68b;
+  seed ^= seed >> 16;
+  gameRandomState = seed ? seed : 1; // xorshift must not start at zero
+}
+
+// Next game random number, in the same 0..RAND_MAX style range as rand()
+int gameRandom() {
+  Uint32 x = gameRandomState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  gameRandomState = x;
+  return (int)(x >> 1);
+}
+
 // Initialize power-up system
 void initPowerUps() {
-    // Free any existing power-ups
-    PowerUp* current = activePowerUps;
-    while (current != NULL) {
-        PowerUp* temp = current;
-        current = current->next;
-        free(temp);
+    // Drop both lists at once by rebuilding the pool's free list
+    for (int i = 0; i < MAX_POWER_UPS - 1; i++) {
+        powerUpPool[i].next = &powerUpPool[i + 1];
     }
+    powerUpPool[MAX_POWER_UPS - 1].next = NULL;
+    freePowerUps = &powerUpPool[0];
+    powerUpsInUse = 0;
+
     activePowerUps = NULL;
-    
-    current = fallingPowerUps;
-    while (current != NULL) {
-        PowerUp* temp = current;
-        current = current->next;
-        free(temp);
-    }
     fallingPowerUps = NULL;
 }
 
+// Take a power-up from the pool, NULL when the pool is used up
+PowerUp* allocPowerUp() {
+    PowerUp* powerUp = freePowerUps;
+    if (powerUp == NULL) {
+        powerUpsRefused++;
+        return NULL;
+    }
+
+    freePowerUps = powerUp->next;
+    powerUpsInUse++;
+    if (powerUpsInUse > powerUpsPeak) {
+        powerUpsPeak = powerUpsInUse;
+    }
+    return powerUp;
+}
+
+// Return a power-up to the pool
+void freePowerUp(PowerUp* powerUp) {
+    powerUp->next = freePowerUps;
+    freePowerUps = powerUp;
+    powerUpsInUse--;
+}
+
 // Create a new power-up
 PowerUp* createPowerUp(int x, int y, PowerUpType type) {
-    PowerUp* powerUp = (PowerUp*)malloc(sizeof(PowerUp));
+    PowerUp* powerUp = allocPowerUp();
     if (powerUp == NULL) {
-        fprintf(stderr, "Failed to allocate memory for power-up\n");
         return NULL;
     }
     
@@ -186,6 +508,7 @@ PowerUp* createPowerUp(int x, int y, PowerUpType type) {
     powerUp->rect.y = y;
     powerUp->rect.w = 20;
     powerUp->rect.h = 20;
+    powerUp->fallY = y;
     
     // Set color based on power-up type
     switch (type) {
@@ -228,18 +551,17 @@ void addFallingPowerUp(int x, int y, PowerUpType type) {
 
 // Activate a power-up effect
 void activatePowerUp(PowerUpType type) {
-    PowerUp* powerUp = (PowerUp*)malloc(sizeof(PowerUp));
-    if (powerUp == NULL) {
-        fprintf(stderr, "Failed to allocate memory for power-up\n");
-        return;
+    // The falling entry was handed back before this is called, so there is
+    // always room to track the effect's expiry
+    PowerUp* powerUp = allocPowerUp();
+    if (powerUp != NULL) {
+        powerUp->type = type;
+        powerUp->active = true;
+        powerUp->duration = 10 * tickRate; // 10 seconds
+        powerUp->next = activePowerUps;
+        activePowerUps = powerUp;
     }
     
-    powerUp->type = type;
-    powerUp->active = true;
-    powerUp->duration = 600; // 10 seconds at 60 FPS
-    powerUp->next = activePowerUps;
-    activePowerUps = powerUp;
-    
     // Apply immediate effect based on type
     switch (type) {
         case POWER_WIDER_PADDLE:
@@ -247,16 +569,27 @@ void activatePowerUp(PowerUpType type) {
             break;
         case POWER_SLOWER_BALL:
             ballSpeed = normalBallSpeed * 0.7f; // Slower ball
-            ball_vx = (ball_vx > 0) ? ballSpeed : -ballSpeed;
-            ball_vy = (ball_vy > 0) ? ballSpeed : -ballSpeed;
+            setBallSpeed(ballSpeed);
             break;
         case POWER_FASTER_BALL:
             ballSpeed = normalBallSpeed * 1.5f; // Faster ball
-            ball_vx = (ball_vx > 0) ? ballSpeed : -ballSpeed;
-            ball_vy = (ball_vy > 0) ? ballSpeed : -ballSpeed;
+            setBallSpeed(ballSpeed);
             break;
         case POWER_MULTI_BALL:
-            // TODO: Implement multiple balls
+            // Split every ball in play into three, fanned out sideways
+            if (ballLaunched) {
+                int count = balls.count;
+                for (int i = 0; i < count; i++) {
+                    addBall(balls.x[i], balls.y[i], -balls.vx[i], balls.vy[i]);
+
+                    // Third ball: the velocity turned 30 degrees and sent
+                    // upward, so it keeps the speed of the ball it split from
+                    float c = cosf(M_PI / 6), s = sinf(M_PI / 6);
+                    float vx = balls.vx[i] * c - balls.vy[i] * s;
+                    float vy = balls.vx[i] * s + balls.vy[i] * c;
+                    addBall(balls.x[i], balls.y[i], vx, -fabsf(vy));
+                }
+            }
             break;
         case POWER_EXTRA_LIFE:
             lives++; // Add an extra life
@@ -265,10 +598,8 @@ void activatePowerUp(PowerUpType type) {
             break;
     }
     
-    // Play power-up sound if sound is enabled
-    if (sound_enabled && sounds[SOUND_POWER_UP] != NULL) {
-        Mix_PlayChannel(-1, sounds[SOUND_POWER_UP], 0);
-    }
+    // Play power-up sound
+    playSound(SOUND_POWER_UP);
 }
 
 // Update active power-ups (decrease duration, remove expired)
@@ -288,8 +619,7 @@ void updatePowerUps() {
                 case POWER_SLOWER_BALL:
                 case POWER_FASTER_BALL:
                     ballSpeed = normalBallSpeed; // Reset ball speed
-                    ball_vx = (ball_vx > 0) ? ballSpeed : -ballSpeed;
-                    ball_vy = (ball_vy > 0) ? ballSpeed : -ballSpeed;
+                    setBallSpeed(ballSpeed);
                     break;
                 default:
                     break;
@@ -303,7 +633,7 @@ void updatePowerUps() {
                 prev->next = current->next;
             }
             current = current->next;
-            free(toRemove);
+            freePowerUp(toRemove);
         } else {
             prev = current;
             current = current->next;
@@ -318,7 +648,8 @@ void updateFallingPowerUps(Rectangle playerBlock) {
     
     while (current != NULL) {
         // Move power-up down
-        current->rect.y += 2;
+        current->fallY += 2 * tickScale;
+        current->rect.y = (int)current->fallY;
         
         // Check if player collected the power-up
         if (current->rect.y + current->rect.h >= playerBlock.y &&
@@ -326,9 +657,6 @@ void updateFallingPowerUps(Rectangle playerBlock) {
             current->rect.x + current->rect.w >= playerBlock.x &&
             current->rect.x <= playerBlock.x + playerBlock.w) {
             
-            // Activate the power-up
-            activatePowerUp(current->type);
-            
             // Remove from falling list
             PowerUp* toRemove = current;
             if (prev == NULL) {
@@ -337,7 +665,11 @@ void updateFallingPowerUps(Rectangle playerBlock) {
                 prev->next = current->next;
             }
             current = current->next;
-            free(toRemove);
+            PowerUpType type = toRemove->type;
+            freePowerUp(toRemove);
+
+            // Activate the power-up
+            activatePowerUp(type);
         }
         // Check if power-up is out of screen
         else if (current->rect.y > SCREEN_HEIGHT) {
@@ -348,7 +680,7 @@ void updateFallingPowerUps(Rectangle playerBlock) {
                 prev->next = current->next;
             }
             current = current->next;
-            free(toRemove);
+            freePowerUp(toRemove);
         } else {
             prev = current;
             current = current->next;
@@ -356,39 +688,402 @@ void updateFallingPowerUps(Rectangle playerBlock) {
     }
 }
 
-// Render falling power-ups
-void renderFallingPowerUps(SDL_Renderer* renderer) {
+// Queue falling power-ups, flushRects() draws them
+void queueFallingPowerUps() {
     PowerUp* current = fallingPowerUps;
     
     while (current != NULL) {
-        drawRectangle(renderer, current->rect);
+        queueRect(current->rect);
         current = current->next;
     }
 }
 
-// Create blocks with different health based on difficulty
-BlockNode *createBlockList(int size) {
-  BlockNode *head = NULL;
-  BlockNode *tail = NULL;
+// Release the ball system
+void freeBallSystem() {
+  free(balls.memory);
+  balls = (BallSystem){0};
+}
+
+// Allocate room for up to capacity balls
+bool allocBallSystem(int capacity) {
+  void *memory = malloc(capacity * 6 * sizeof(float));
+  if (memory == NULL) {
+    fprintf(stderr, "Failed to allocate memory for balls\n");
+    return false;
+  }
+  freeBallSystem();
+  balls.memory = memory;
+  balls.capacity = capacity;
+
+  float *cursor = (float *)memory;
+  balls.x = cursor;
+  balls.y = cursor + capacity;
+  balls.vx = cursor + 2 * capacity;
+  balls.vy = cursor + 3 * capacity;
+  balls.prevX = cursor + 4 * capacity;
+  balls.prevY = cursor + 5 * capacity;
+  return true;
+}
+
+// Add a ball, returns its index or -1 when the system is full
+int addBall(float x, float y, float vx, float vy) {
+  if (balls.count >= balls.capacity) {
+    return -1;
+  }
+  int i = balls.count++;
+  balls.x[i] = balls.prevX[i] = x;
+  balls.y[i] = balls.prevY[i] = y;
+  balls.vx[i] = vx;
+  balls.vy[i] = vy;
+  return i;
+}
+
+// Remove a ball by moving the last one into its slot
+void removeBall(int i) {
+  int last = --balls.count;
+  balls.x[i] = balls.x[last];
+  balls.y[i] = balls.y[last];
+  balls.vx[i] = balls.vx[last];
+  balls.vy[i] = balls.vy[last];
+  balls.prevX[i] = balls.prevX[last];
+  balls.prevY[i] = balls.prevY[last];
+}
+
+// Set every ball's speed, keeping the direction it travels in on each axis
+void setBallSpeed(float speed) {
+  for (int i = 0; i < balls.count; i++) {
+    balls.vx[i] = (balls.vx[i] > 0) ? speed : -speed;
+    balls.vy[i] = (balls.vy[i] > 0) ? speed : -speed;
+  }
+}
+
+// Release the particle pool
+void freeParticleSystem() {
+  free(particles.memory);
+  particles = (ParticleSystem){0};
+}
+
+// Allocate room for up to capacity live particles
+bool allocParticleSystem(int capacity) {
+  void *memory = malloc(capacity * (5 * sizeof(float) + sizeof(SDL_Color)));
+  if (memory == NULL) {
+    fprintf(stderr, "Failed to allocate memory for particles\n");
+    return false;
+  }
+  freeParticleSystem();
+  particles.memory = memory;
+  particles.capacity = capacity;
+
+  float *cursor = (float *)memory;
+  particles.x = cursor;
+  particles.y = cursor + capacity;
+  particles.vx = cursor + 2 * capacity;
+  particles.vy = cursor + 3 * capacity;
+  particles.life = cursor + 4 * capacity;
+  particles.color = (SDL_Color *)(cursor + 5 * capacity);
+  return true;
+}
+
+// Particle random numbers (xorshift32), kept apart from gameRandom()
+static inline Uint32 particleRandom() {
+  Uint32 x = particleRandomState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return particleRandomState = x;
+}
+
+// Burst of particles flying out from a hit. Whatever doesn't fit in the
+// pool is dropped and counted.
+void createCollisionEffect(int x, int y, SDL_Color color) {
+  for (int n = 0; n < PARTICLES_PER_EFFECT; n++) {
+    if (particles.count >= particles.capacity) {
+      particles.refused += PARTICLES_PER_EFFECT - n;
+      break;
+    }
+    Uint32 r = particleRandom();
+    float angle = (r & 0xffff) * (float)(M_PI * 2 / 65536.0);
+    float speed = 1.0f + (r >> 16 & 0xff) * (3.0f / 255.0f);
+
+    int i = particles.count++;
+    particles.x[i] = x;
+    particles.y[i] = y;
+    particles.vx[i] = cosf(angle) * speed;
+    particles.vy[i] = sinf(angle) * speed;
+    particles.life[i] = PARTICLE_LIFETIME * (0.5f + (r >> 24) * (0.5f / 255.0f));
+    particles.color[i] = color;
+  }
+  if (particles.count > particles.peak) {
+    particles.peak = particles.count;
+  }
+}
+
+// Move, pull down and age every particle, then drop the expired ones. The
+// update is a plain loop over the arrays with no branches, so it vectorizes.
+void updateParticles() {
+  int n = particles.count;
+  float *restrict x = particles.x, *restrict y = particles.y;
+  float *restrict vx = particles.vx, *restrict vy = particles.vy;
+  float *restrict life = particles.life;
+  float scale = tickScale;
+  float gravity = PARTICLE_GRAVITY * scale;
+
+  for (int i = 0; i < n; i++) {
+    x[i] += vx[i] * scale;
+    y[i] += vy[i] * scale;
+    vy[i] += gravity;
+    life[i] -= scale;
+  }
+
+  // Swap the last live particle into each expired slot
+  for (int i = n - 1; i >= 0; i--) {
+    if (life[i] <= 0) {
+      int last = --n;
+      x[i] = x[last];
+      y[i] = y[last];
+      vx[i] = vx[last];
+      vy[i] = vy[last];
+      life[i] = life[last];
+      particles.color[i] = particles.color[last];
+    }
+  }
+  particles.count = n;
+}
+
+// Check if a block is still standing
+static inline bool isBlockLive(int i) {
+  return (blocks.liveMask[i >> 6] >> (i & 63)) & 1;
+}
+
+// Release the block store
+void freeBlockStore() {
+  free(blocks.memory);
+  blocks = (BlockStore){0};
+}
+
+// Make room for a level of the given size. The arrays are carved out of a
+// single allocation, which is only replaced when a bigger level comes along.
+bool allocBlockStore(int size) {
+  if (size > blocks.capacity) {
+    int maskWords = (size + 63) / 64;
+    size_t bytes = maskWords * sizeof(Uint64) +
+                   size * (6 * sizeof(int) + sizeof(SDL_Color) + 2);
+    void *memory = malloc(bytes);
+    if (memory == NULL) {
+      fprintf(stderr, "Failed to allocate memory for blocks\n");
+      return false;
+    }
+    freeBlockStore();
+    blocks.memory = memory;
+    blocks.capacity = size;
+
+    // Widest types first so every array stays aligned
+    char *cursor = (char *)memory;
+    blocks.liveMask = (Uint64 *)cursor;
+    cursor += maskWords * sizeof(Uint64);
+    blocks.x = (int *)cursor;
+    cursor += size * sizeof(int);
+    blocks.y = (int *)cursor;
+    cursor += size * sizeof(int);
+    blocks.w = (int *)cursor;
+    cursor += size * sizeof(int);
+    blocks.h = (int *)cursor;
+    cursor += size * sizeof(int);
+    blocks.health = (int *)cursor;
+    cursor += size * sizeof(int);
+    blocks.scoreValue = (int *)cursor;
+    cursor += size * sizeof(int);
+    blocks.color = (SDL_Color *)cursor;
+    cursor += size * sizeof(SDL_Color);
+    blocks.powerUpType = (Uint8 *)cursor;
+    cursor += size;
+    blocks.dropsPowerUp = (Uint8 *)cursor;
+  }
+
+  blocks.count = size;
+  memset(blocks.liveMask, 0, ((size + 63) / 64) * sizeof(Uint64));
+  return true;
+}
+
+// Release the block grid
+void freeBlockGrid() {
+  free(blockGrid.cellStart);
+  free(blockGrid.cellCount);
+  free(blockGrid.cellItems);
+  blockGrid = (BlockGrid){0};
+}
+
+// Get the range of grid cells covered by a box, clamped to the grid.
+// Returns false if the box lies completely outside the grid.
+bool gridCellRange(int left, int top, int right, int bottom,
+                   int *col0, int *row0, int *col1, int *row1) {
+  if (blockGrid.cols == 0 || right < blockGrid.originX ||
+      bottom < blockGrid.originY) {
+    return false;
+  }
+
+  *col0 = (left - blockGrid.originX) / GRID_CELL_SIZE;
+  *row0 = (top - blockGrid.originY) / GRID_CELL_SIZE;
+  *col1 = (right - blockGrid.originX) / GRID_CELL_SIZE;
+  *row1 = (bottom - blockGrid.originY) / GRID_CELL_SIZE;
+
+  if (*col0 >= blockGrid.cols || *row0 >= blockGrid.rows) {
+    return false;
+  }
+  if (*col0 < 0) *col0 = 0;
+  if (*row0 < 0) *row0 = 0;
+  if (*col1 >= blockGrid.cols) *col1 = blockGrid.cols - 1;
+  if (*row1 >= blockGrid.rows) *row1 = blockGrid.rows - 1;
+  return true;
+}
+
+// Bucket every block of a freshly laid out level into the grid
+void buildBlockGrid() {
+  freeBlockGrid();
+  if (blocks.count == 0) return;
+
+  // Find the bounds of the layout
+  int minX = blocks.x[0], minY = blocks.y[0];
+  int maxX = blocks.x[0] + blocks.w[0];
+  int maxY = blocks.y[0] + blocks.h[0];
+  for (int i = 1; i < blocks.count; i++) {
+    if (blocks.x[i] < minX) minX = blocks.x[i];
+    if (blocks.y[i] < minY) minY = blocks.y[i];
+    if (blocks.x[i] + blocks.w[i] > maxX) maxX = blocks.x[i] + blocks.w[i];
+    if (blocks.y[i] + blocks.h[i] > maxY) maxY = blocks.y[i] + blocks.h[i];
+  }
+
+  blockGrid.originX = minX;
+  blockGrid.originY = minY;
+  blockGrid.cols = (maxX - minX) / GRID_CELL_SIZE + 1;
+  blockGrid.rows = (maxY - minY) / GRID_CELL_SIZE + 1;
+
+  int cellTotal = blockGrid.cols * blockGrid.rows;
+  blockGrid.cellStart = (int *)calloc(cellTotal + 1, sizeof(int));
+  blockGrid.cellCount = (int *)calloc(cellTotal, sizeof(int));
+  if (blockGrid.cellStart == NULL || blockGrid.cellCount == NULL) {
+    fprintf(stderr, "Failed to allocate memory for block grid\n");
+    freeBlockGrid();
+    return;
+  }
+
+  // First pass: count the blocks landing in each cell
+  int col0, row0, col1, row1;
+  for (int i = 0; i < blocks.count; i++) {
+    if (!gridCellRange(blocks.x[i], blocks.y[i], blocks.x[i] + blocks.w[i],
+                       blocks.y[i] + blocks.h[i], &col0, &row0, &col1, &row1)) {
+      continue;
+    }
+    for (int row = row0; row <= row1; row++) {
+      for (int col = col0; col <= col1; col++) {
+        blockGrid.cellStart[row * blockGrid.cols + col + 1]++;
+      }
+    }
+  }
+
+  // Turn the counts into packed offsets
+  for (int i = 0; i < cellTotal; i++) {
+    blockGrid.cellStart[i + 1] += blockGrid.cellStart[i];
+  }
+
+  blockGrid.cellItems =
+      (int *)malloc(blockGrid.cellStart[cellTotal] * sizeof(int));
+  if (blockGrid.cellItems == NULL) {
+    fprintf(stderr, "Failed to allocate memory for block grid\n");
+    freeBlockGrid();
+    return;
+  }
+
+  // Second pass: drop every block into its cells
+  for (int i = 0; i < blocks.count; i++) {
+    if (!gridCellRange(blocks.x[i], blocks.y[i], blocks.x[i] + blocks.w[i],
+                       blocks.y[i] + blocks.h[i], &col0, &row0, &col1, &row1)) {
+      continue;
+    }
+    for (int row = row0; row <= row1; row++) {
+      for (int col = col0; col <= col1; col++) {
+        int cell = row * blockGrid.cols + col;
+        blockGrid.cellItems[blockGrid.cellStart[cell] +
+                            blockGrid.cellCount[cell]++] = i;
+      }
+    }
+  }
+}
+
+// Take a destroyed block out of every cell it was bucketed into
+void gridRemoveBlock(int block) {
+  int col0, row0, col1, row1;
+  if (!gridCellRange(blocks.x[block], blocks.y[block],
+                     blocks.x[block] + blocks.w[block],
+                     blocks.y[block] + blocks.h[block],
+                     &col0, &row0, &col1, &row1)) {
+    return;
+  }
+
+  for (int row = row0; row <= row1; row++) {
+    for (int col = col0; col <= col1; col++) {
+      int cell = row * blockGrid.cols + col;
+      int *items = &blockGrid.cellItems[blockGrid.cellStart[cell]];
+      for (int i = 0; i < blockGrid.cellCount[cell]; i++) {
+        if (items[i] == block) {
+          // Swap-remove, order inside a cell doesn't matter
+          items[i] = items[--blockGrid.cellCount[cell]];
+          break;
+        }
+      }
+    }
+  }
+}
+
+// Find the block overlapping the ball, looking only at nearby cells. When
+// several blocks overlap, the lowest index wins, matching layout order.
+// Returns -1 if there is no hit.
+int gridFindCollision(struct Arc ball) {
+  int col0, row0, col1, row1;
+  if (!gridCellRange(ball.x - ball.r, ball.y - ball.r, ball.x + ball.r,
+                     ball.y + ball.r, &col0, &row0, &col1, &row1)) {
+    return -1;
+  }
+
+  int hit = -1;
+  for (int row = row0; row <= row1; row++) {
+    for (int col = col0; col <= col1; col++) {
+      int cell = row * blockGrid.cols + col;
+      int *items = &blockGrid.cellItems[blockGrid.cellStart[cell]];
+      for (int i = 0; i < blockGrid.cellCount[cell]; i++) {
+        int b = items[i];
+        // Simple AABB (Axis-Aligned Bounding Box) collision
+        if (ball.x + ball.r > blocks.x[b] &&
+            ball.x - ball.r < blocks.x[b] + blocks.w[b] &&
+            ball.y + ball.r > blocks.y[b] &&
+            ball.y - ball.r < blocks.y[b] + blocks.h[b] &&
+            (hit < 0 || b < hit)) {
+          hit = b;
+        }
+      }
+    }
+  }
+  return hit;
+}
 
+// Lay out a level's blocks with different health based on difficulty
+void createBlocks(int size) {
   int blockWidth = 50;
   int blockHeight = 20;
   int padding = 10;
   int blocksPerRow = SCREEN_WIDTH / (blockWidth + padding);
   
-  // Seed random number generator if not done already
-  static bool seeded = false;
-  if (!seeded) {
-    srand(time(NULL));
-    seeded = true;
+  if (!allocBlockStore(size)) {
+    blocks.count = 0;
+    freeBlockGrid();
+    return;
   }
 
   for (int i = 0; i < size; i++) {
-    BlockNode *newNode = (BlockNode *)malloc(sizeof(BlockNode));
-    newNode->block.x = (i % blocksPerRow) * (blockWidth + padding) + 5;
-    newNode->block.y = (i / blocksPerRow) * (blockHeight + padding);
-    newNode->block.w = blockWidth;
-    newNode->block.h = blockHeight;
+    blocks.x[i] = (i % blocksPerRow) * (blockWidth + padding) + 5;
+    blocks.y[i] = (i / blocksPerRow) * (blockHeight + padding);
+    blocks.w[i] = blockWidth;
+    blocks.h[i] = blockHeight;
     
     // Determine block health based on row and difficulty
     int row = i / blocksPerRow;
@@ -398,128 +1093,850 @@ BlockNode *createBlockList(int size) {
         // Top rows have higher health on higher difficulties
         switch(currentDifficulty) {
             case DIFFICULTY_EASY:
-                newNode->health = 1;
+                blocks.health[i] = 1;
                 break;
             case DIFFICULTY_MEDIUM:
-                newNode->health = row == 0 ? 2 : 1;
+                blocks.health[i] = row == 0 ? 2 : 1;
                 break;
             case DIFFICULTY_HARD:
-                newNode->health = row == 0 ? 3 : (row == 1 ? 2 : 1);
+                blocks.health[i] = row == 0 ? 3 : (row == 1 ? 2 : 1);
                 break;
             default:
-                newNode->health = 1;
+                blocks.health[i] = 1;
         }
     } else {
-        newNode->health = 1;
+        blocks.health[i] = 1;
     }
     
     // Set score value based on health
-    newNode->scoreValue = newNode->health * 10;
+    blocks.scoreValue[i] = blocks.health[i] * 10;
     
     // Determine color based on health
-    switch (newNode->health) {
+    switch (blocks.health[i]) {
         case 1:
-            newNode->block.color.r = 0;
-            newNode->block.color.g = 255;
-            newNode->block.color.b = 0;
+            blocks.color[i] = (SDL_Color){0, 255, 0, 255};
             break;
         case 2:
-            newNode->block.color.r = 255;
-            newNode->block.color.g = 255;
-            newNode->block.color.b = 0;
+            blocks.color[i] = (SDL_Color){255, 255, 0, 255};
             break;
         case 3:
-            newNode->block.color.r = 255;
-            newNode->block.color.g = 0;
-            newNode->block.color.b = 0;
+            blocks.color[i] = (SDL_Color){255, 0, 0, 255};
             break;
         default:
-            newNode->block.color.r = rand() % 256;
-            newNode->block.color.g = rand() % 256;
-            newNode->block.color.b = rand() % 256;
+            blocks.color[i] = (SDL_Color){gameRandom() % 256, gameRandom() % 256,
+                                          gameRandom() % 256, 255};
     }
-    newNode->block.color.a = 255;
     
     // Random chance to drop a power-up (10%)
-    if (rand() % 10 == 0) {
-        newNode->dropsPowerUp = true;
-        newNode->powerUpType = (PowerUpType)(rand() % (POWER_TOTAL - 1) + 1);
+    if (gameRandom() % 10 == 0) {
+        blocks.dropsPowerUp[i] = true;
+        blocks.powerUpType[i] = gameRandom() % (POWER_TOTAL - 1) + 1;
     } else {
-        newNode->dropsPowerUp = false;
-        newNode->powerUpType = POWER_NONE;
+        blocks.dropsPowerUp[i] = false;
+        blocks.powerUpType[i] = POWER_NONE;
     }
-    
-    newNode->next = NULL;
 
-    if (head == NULL) {
-      head = newNode;
-      tail = newNode;
-    } else {
-      tail->next = newNode;
-      tail = newNode;
-    }
+    blocks.liveMask[i >> 6] |= (Uint64)1 << (i & 63);
   }
 
-  return head;
+  // Index the new layout for collision queries
+  buildBlockGrid();
+}
+
+// Drop the current level's blocks (the allocation is kept for the next one)
+void clearBlocks() {
+  blocks.count = 0;
+  freeBlockGrid();
 }
 
-void drawBlocks(SDL_Renderer *renderer, BlockNode *head) {
-  BlockNode *current = head;
-  while (current != NULL) {
-    drawRectangle(renderer, current->block);
-    current = current->next;
+// FNV-1a over a block of bytes, continuing from hash (HASH_SEED to start)
+#define HASH_SEED 2166136261u
+Uint32 hashBytes(const Uint8 *data, size_t size, Uint32 hash) {
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * 16777619u;
   }
+  return hash;
 }
 
-void drawRectangle(SDL_Renderer *renderer, Rectangle rectangle) {
-  SDL_Rect rect;
-  rect.x = rectangle.x;
-  rect.y = rectangle.y;
-  rect.w = rectangle.w;
-  rect.h = rectangle.h;
+// Binary level files (.brl). A 16 byte header is followed by the brick data
+// in the same column layout and types as the block store, so a level loads
+// with one copy per column and no per-brick parsing:
+//   "BRLV", byte order mark 0x01020304 (Uint32), version (Uint16),
+//   reserved (Uint16), brick count (Uint32), then for n bricks
+//   x[n], y[n], w[n], h[n], health[n], scoreValue[n] (Sint32 each),
+//   color[n] (r, g, b, a), powerUpType[n] (Uint8), dropsPowerUp[n] (0 or 1)
+// Numbers are in the writer's byte order, the mark tells a foreign file apart.
+#define LEVEL_MAGIC "BRLV"
+#define LEVEL_BYTE_ORDER 0x01020304u
+#define LEVEL_VERSION 1
+#define LEVEL_HEADER_SIZE 16
+#define LEVEL_BRICK_SIZE (6 * 4 + 4 + 2)
+#define LEVEL_MAX_BRICKS (1 << 24)
+#define LEVEL_MAX_Y (1 << 20) // Bricks may sit this far above or below the top
 
-  SDL_SetRenderDrawColor(renderer, rectangle.color.r, rectangle.color.g,
-                         rectangle.color.b,
-                         rectangle.color.a); // Light blue color
-  SDL_RenderFillRect(renderer, &rect);
+typedef struct {
+  char magic[4];
+  Uint32 byteOrder;
+  Uint16 version;
+  Uint16 reserved;
+  Uint32 count;
+} LevelHeader;
 
-  SDL_SetRenderDrawColor(renderer, 0, 0, 0,
-                         255); // Set back to black for future draws
+// Write the blocks currently in the store as a binary level
+bool saveLevelFile(const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to create level file %s\n", path);
+    return false;
+  }
+
+  int n = blocks.count;
+  LevelHeader header = {LEVEL_MAGIC, LEVEL_BYTE_ORDER, LEVEL_VERSION, 0,
+                        (Uint32)n};
+  int *columns[6] = {blocks.x, blocks.y, blocks.w,
+                     blocks.h, blocks.health, blocks.scoreValue};
+  bool ok = fwrite(&header, LEVEL_HEADER_SIZE, 1, file) == 1;
+  for (int c = 0; c < 6 && ok; c++) {
+    ok = fwrite(columns[c], sizeof(int), n, file) == (size_t)n;
+  }
+  ok = ok && fwrite(blocks.color, sizeof(SDL_Color), n, file) == (size_t)n &&
+       fwrite(blocks.powerUpType, 1, n, file) == (size_t)n &&
+       fwrite(blocks.dropsPowerUp, 1, n, file) == (size_t)n;
+  if (fclose(file) != 0) ok = false;
+
+  if (!ok) {
+    fprintf(stderr, "Failed to write level file %s\n", path);
+  }
+  return ok;
 }
 
-void drawArc(SDL_Renderer *renderer, struct Arc arc) {
-  SDL_SetRenderDrawColor(renderer, arc.color.r, arc.color.g, arc.color.b,
-                         arc.color.a);
+// Check a brick of the block store can be played: a real size, roughly on
+// screen horizontally, a known power-up and at least one hit to break it.
+// Keeps the collision grid small and every lookup table index in range.
+bool levelBrickValid(int i) {
+  return blocks.w[i] > 0 && blocks.w[i] <= SCREEN_WIDTH &&
+         blocks.h[i] > 0 && blocks.h[i] <= SCREEN_WIDTH &&
+         blocks.x[i] >= -SCREEN_WIDTH && blocks.x[i] <= 2 * SCREEN_WIDTH &&
+         blocks.y[i] >= -LEVEL_MAX_Y && blocks.y[i] <= LEVEL_MAX_Y &&
+         blocks.health[i] >= 1 && blocks.powerUpType[i] < POWER_TOTAL &&
+         blocks.dropsPowerUp[i] <= 1;
+}
 
-  for (int w = 0; w < arc.r * 2; w++) {
-    for (int h = 0; h < arc.r * 2; h++) {
-      int dx = arc.r - w;
-      int dy = arc.r - h;
-      double distanceSquared = dx * dx + dy * dy;
+// Map (or on Windows, read) a whole file into memory
+const Uint8 *mapLevelFile(const char *path, size_t *size) {
+#ifdef _WIN32
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return NULL;
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  Uint8 *data = length > 0 ? (Uint8 *)malloc(length) : NULL;
+  if (data != NULL && fread(data, 1, length, file) != (size_t)length) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  *size = length;
+  return data;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return NULL;
+  struct stat info;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) return NULL;
+  *size = info.st_size;
+  return (const Uint8 *)data;
+#endif
+}
 
-      if (distanceSquared <= arc.r * arc.r) {
-        double angle = atan2(dy, dx);
+void unmapLevelFile(const Uint8 *data, size_t size) {
+#ifdef _WIN32
+  (void)size;
+  free((void *)data);
+#else
+  munmap((void *)data, size);
+#endif
+}
 
-        if (angle < 0) {
-          angle += 2 * M_PI;
-        }
+// Load a binary level into the block store, replacing the current layout.
+// Every brick starts out standing; the broad-phase grid is rebuilt after.
+bool loadLevelFile(const char *path) {
+  size_t size = 0;
+  const Uint8 *data = mapLevelFile(path, &size);
+  if (data == NULL) {
+    fprintf(stderr, "Failed to open level file %s\n", path);
+    return false;
+  }
 
-        if (angle >= arc.startAngle && angle <= arc.endAngle) {
-          SDL_RenderDrawPoint(renderer, arc.x + dx, arc.y + dy);
-        }
-      }
+  LevelHeader header;
+  bool valid = size >= LEVEL_HEADER_SIZE;
+  if (valid) {
+    memcpy(&header, data, LEVEL_HEADER_SIZE);
+    valid = memcmp(header.magic, LEVEL_MAGIC, 4) == 0 &&
+            header.byteOrder == LEVEL_BYTE_ORDER &&
+            header.version == LEVEL_VERSION &&
+            header.count <= LEVEL_MAX_BRICKS &&
+            size == LEVEL_HEADER_SIZE + (size_t)header.count * LEVEL_BRICK_SIZE;
+  }
+  if (!valid || !allocBlockStore((int)header.count)) {
+    if (!valid) fprintf(stderr, "%s is not a valid level file\n", path);
+    unmapLevelFile(data, size);
+    return false;
+  }
+
+  int n = (int)header.count;
+  const Uint8 *cursor = data + LEVEL_HEADER_SIZE;
+  int *columns[6] = {blocks.x, blocks.y, blocks.w,
+                     blocks.h, blocks.health, blocks.scoreValue};
+  for (int c = 0; c < 6; c++) {
+    memcpy(columns[c], cursor, n * sizeof(int));
+    cursor += n * sizeof(int);
+  }
+  memcpy(blocks.color, cursor, n * sizeof(SDL_Color));
+  cursor += n * sizeof(SDL_Color);
+  memcpy(blocks.powerUpType, cursor, n);
+  cursor += n;
+  memcpy(blocks.dropsPowerUp, cursor, n);
+  unmapLevelFile(data, size);
+
+  // One cheap pass over the copied columns before anything trusts them
+  for (int i = 0; i < n; i++) {
+    if (!levelBrickValid(i)) {
+      fprintf(stderr, "%s: brick %d is out of range\n", path, i);
+      clearBlocks();
+      return false;
     }
   }
 
-  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+  // All bricks live: whole words at once, then the partial last word
+  memset(blocks.liveMask, 0xff, (n / 64) * sizeof(Uint64));
+  if (n % 64 != 0) {
+    blocks.liveMask[n / 64] = ((Uint64)1 << (n % 64)) - 1;
+  }
+
+  buildBlockGrid();
+  return true;
 }
 
-int checkCollision(struct Arc ball, Rectangle player) {
-  // Check if the ball's position is within the player's bounds horizontally
-  if (ball.x + ball.r > player.x && ball.x - ball.r < player.x + player.w) {
-    // Check if the ball's position is within the player's bounds vertically
-    if (ball.y + ball.r > player.y && ball.y - ball.r < player.y + player.h) {
-      return 1; // Collision detected
+// Parse a power-up name from a text level
+bool parsePowerUpName(const char *name, Uint8 *type) {
+  static const char *names[POWER_TOTAL] = {"none",   "wider", "slower",
+                                           "faster", "multi", "life"};
+  for (int i = 0; i < POWER_TOTAL; i++) {
+    if (strcmp(name, names[i]) == 0) {
+      *type = (Uint8)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Convert a text level to the binary format. One brick per line:
+//   x y w h health [power-up [score [r g b]]]
+// power-up is none, wider, slower, faster, multi or life; the score defaults
+// to health * 10 and the color to the usual color for the health.
+// Blank lines and everything after a # are ignored.
+bool convertLevelFile(const char *textPath, const char *binaryPath) {
+  FILE *file = fopen(textPath, "r");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open %s\n", textPath);
+    return false;
+  }
+
+  int n = 0;
+  int lineNumber = 0;
+  bool ok = true;
+  char line[256];
+  while (ok && fgets(line, sizeof(line), file) != NULL) {
+    lineNumber++;
+    char *comment = strchr(line, '#');
+    if (comment != NULL) *comment = '\0';
+
+    // The %n after each optional group records where the line was used up
+    // to, anything but whitespace after that is an error
+    int x, y, w, h, health, brickScore, r, g, b;
+    int end5 = 0, end6 = 0, end7 = 0, end10 = 0;
+    char power[16] = "none";
+    int fields = sscanf(line, "%d %d %d %d %d%n %15s%n %d%n %d %d %d%n", &x,
+                        &y, &w, &h, &health, &end5, power, &end6, &brickScore,
+                        &end7, &r, &g, &b, &end10);
+    if (fields == EOF) continue; // Blank or comment only
+
+    int used = fields == 5 ? end5 : fields == 6 ? end6
+             : fields == 7 ? end7 : fields == 10 ? end10 : 0;
+    Uint8 type = POWER_NONE;
+    if (used == 0 || line[used + strspn(line + used, " \t\r\n")] != '\0' ||
+        w <= 0 || h <= 0 || health < 1 || !parsePowerUpName(power, &type)) {
+      fprintf(stderr, "%s:%d: expected x y w h health [power-up [score [r g b]]]\n",
+              textPath, lineNumber);
+      ok = false;
+      break;
+    }
+    if (fields == 10 && (r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255)) {
+      fprintf(stderr, "%s:%d: color components must be 0 to 255\n", textPath,
+              lineNumber);
+      ok = false;
+      break;
+    }
+
+    if (n == blocks.capacity) {
+      // Grow by doubling, keeping the bricks read so far
+      BlockStore old = blocks;
+      blocks = (BlockStore){0};
+      ok = allocBlockStore(n < 64 ? 64 : n * 2);
+      if (ok) {
+        memcpy(blocks.x, old.x, n * sizeof(int));
+        memcpy(blocks.y, old.y, n * sizeof(int));
+        memcpy(blocks.w, old.w, n * sizeof(int));
+        memcpy(blocks.h, old.h, n * sizeof(int));
+        memcpy(blocks.health, old.health, n * sizeof(int));
+        memcpy(blocks.scoreValue, old.scoreValue, n * sizeof(int));
+        memcpy(blocks.color, old.color, n * sizeof(SDL_Color));
+        memcpy(blocks.powerUpType, old.powerUpType, n);
+        memcpy(blocks.dropsPowerUp, old.dropsPowerUp, n);
+      }
+      free(old.memory);
+      if (!ok) break;
+    }
+
+    blocks.x[n] = x;
+    blocks.y[n] = y;
+    blocks.w[n] = w;
+    blocks.h[n] = h;
+    blocks.health[n] = health;
+    blocks.scoreValue[n] = fields >= 7 ? brickScore : health * 10;
+    if (fields == 10) {
+      blocks.color[n] = (SDL_Color){(Uint8)r, (Uint8)g, (Uint8)b, 255};
+    } else {
+      blocks.color[n] = health == 1   ? (SDL_Color){0, 255, 0, 255}
+                        : health == 2 ? (SDL_Color){255, 255, 0, 255}
+                                      : (SDL_Color){255, 0, 0, 255};
+    }
+    blocks.powerUpType[n] = type;
+    blocks.dropsPowerUp[n] = type != POWER_NONE;
+    if (!levelBrickValid(n)) {
+      fprintf(stderr, "%s:%d: brick is out of range\n", textPath, lineNumber);
+      ok = false;
+      break;
+    }
+    n++;
+  }
+  fclose(file);
+
+  if (ok) {
+    blocks.count = n;
+    ok = saveLevelFile(binaryPath);
+  }
+  if (ok) {
+    printf("%s: %d bricks -> %s\n", textPath, n, binaryPath);
+  }
+  clearBlocks();
+  freeBlockStore();
+  return ok;
+}
+
+// Read a level sequence: one binary level file per line, relative to the
+// sequence file's own directory. Blank lines and # comments are skipped.
+bool loadLevelList(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open level list %s\n", path);
+    return false;
+  }
+
+  const char *slash = strrchr(path, '/');
+  int dirLength = slash != NULL ? (int)(slash - path + 1) : 0;
+
+  char line[512];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    char *end = strchr(line, '#');
+    if (end == NULL) end = line + strlen(line);
+    while (end > line && (end[-1] == '\n' || end[-1] == '\r' ||
+                          end[-1] == ' ' || end[-1] == '\t')) {
+      end--;
+    }
+    *end = '\0';
+    if (line[0] == '\0') continue;
+    if (levelFileCount == 0xffff) {
+      fprintf(stderr, "Level list %s names too many levels\n", path);
+      fclose(file);
+      return false;
+    }
+
+    char **grown = (char **)realloc(levelFiles,
+                                    (levelFileCount + 1) * sizeof(char *));
+    char *levelPath = (char *)malloc(dirLength + strlen(line) + 1);
+    if (grown == NULL || levelPath == NULL) {
+      free(levelPath);
+      if (grown != NULL) levelFiles = grown;
+      fclose(file);
+      return false;
+    }
+    levelFiles = grown;
+    memcpy(levelPath, path, dirLength);
+    strcpy(levelPath + dirLength, line);
+    levelFiles[levelFileCount++] = levelPath;
+  }
+  fclose(file);
+
+  if (levelFileCount == 0) {
+    fprintf(stderr, "Level list %s names no levels\n", path);
+    return false;
+  }
+
+  // A file that can't be read hashes to 0 and plays as a generated level
+  levelFileHashes = (Uint32 *)malloc(levelFileCount * sizeof(Uint32));
+  if (levelFileHashes == NULL) return false;
+  for (int i = 0; i < levelFileCount; i++) {
+    size_t size = 0;
+    const Uint8 *data = mapLevelFile(levelFiles[i], &size);
+    levelFileHashes[i] = 0;
+    if (data != NULL) {
+      levelFileHashes[i] = hashBytes(data, size, HASH_SEED);
+      unmapLevelFile(data, size);
+    }
+  }
+  return true;
+}
+
+// Hash of the whole sequence: the file hashes in play order
+Uint32 levelListHash() {
+  Uint32 hash = HASH_SEED;
+  for (int i = 0; i < levelFileCount; i++) {
+    Uint8 bytes[4] = {levelFileHashes[i] & 0xff, (levelFileHashes[i] >> 8) & 0xff,
+                      (levelFileHashes[i] >> 16) & 0xff, levelFileHashes[i] >> 24};
+    hash = hashBytes(bytes, sizeof(bytes), hash);
+  }
+  return hash;
+}
+
+void freeLevelList() {
+  for (int i = 0; i < levelFileCount; i++) {
+    free(levelFiles[i]);
+  }
+  free(levelFiles);
+  free(levelFileHashes);
+  levelFiles = NULL;
+  levelFileHashes = NULL;
+  levelFileCount = 0;
+}
+
+// Queue every standing block, flushRects() draws them
+void queueBlocks() {
+  int words = (blocks.count + 63) / 64;
+  for (int word = 0; word < words; word++) {
+    // Skip 64 destroyed blocks at a time
+    Uint64 live = blocks.liveMask[word];
+    while (live != 0) {
+      int i = word * 64 + __builtin_ctzll(live);
+      live &= live - 1;
+
+      Rectangle block = {blocks.x[i], blocks.y[i], blocks.w[i], blocks.h[i],
+                         blocks.color[i]};
+      queueRect(block);
+    }
+  }
+}
+
+void drawRectangle(SDL_Renderer *renderer, Rectangle rectangle) {
+  SDL_Rect rect;
+  rect.x = rectangle.x;
+  rect.y = rectangle.y;
+  rect.w = rectangle.w;
+  rect.h = rectangle.h;
+
+  SDL_SetRenderDrawColor(renderer, rectangle.color.r, rectangle.color.g,
+                         rectangle.color.b,
+                         rectangle.color.a); // Light blue color
+  SDL_RenderFillRect(renderer, &rect);
+  drawCalls++;
+
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0,
+                         255); // Set back to black for future draws
+}
+
+// Release the rectangle batch buffers
+void freeRectBatch() {
+  free(rectBatch.vertices);
+  free(rectBatch.indices);
+  rectBatch = (RectBatch){0};
+}
+
+// Make room for at least needed rectangles in the batch
+static bool growRectBatch(int needed) {
+  int capacity = rectBatch.capacity ? rectBatch.capacity * 2 : 256;
+  while (capacity < needed) {
+    capacity *= 2;
+  }
+  SDL_Vertex *vertices = (SDL_Vertex *)realloc(
+      rectBatch.vertices, capacity * 4 * sizeof(SDL_Vertex));
+  if (vertices == NULL) return false;
+  rectBatch.vertices = vertices;
+  int *indices = (int *)realloc(rectBatch.indices, capacity * 6 * sizeof(int));
+  if (indices == NULL) return false;
+  rectBatch.indices = indices;
+
+  // Two triangles per quad, same pattern for every rectangle
+  for (int q = rectBatch.capacity; q < capacity; q++) {
+    int base = q * 4;
+    int *tri = &indices[q * 6];
+    tri[0] = base; tri[1] = base + 1; tri[2] = base + 2;
+    tri[3] = base + 2; tri[4] = base + 1; tri[5] = base + 3;
+  }
+  rectBatch.capacity = capacity;
+  return true;
+}
+
+// Queue a filled rectangle, it is drawn by the next flushRects()
+void queueRect(Rectangle rectangle) {
+  if (rectBatch.count == rectBatch.capacity &&
+      !growRectBatch(rectBatch.count + 1)) {
+    return;
+  }
+
+  float x0 = rectangle.x, y0 = rectangle.y;
+  float x1 = x0 + rectangle.w, y1 = y0 + rectangle.h;
+  SDL_Vertex *v = &rectBatch.vertices[rectBatch.count * 4];
+  v[0] = (SDL_Vertex){{x0, y0}, rectangle.color, {0, 0}};
+  v[1] = (SDL_Vertex){{x1, y0}, rectangle.color, {0, 0}};
+  v[2] = (SDL_Vertex){{x0, y1}, rectangle.color, {0, 0}};
+  v[3] = (SDL_Vertex){{x1, y1}, rectangle.color, {0, 0}};
+  rectBatch.count++;
+}
+
+// Draw every queued rectangle in one call
+void flushRects(SDL_Renderer *renderer) {
+  if (rectBatch.count == 0) return;
+  SDL_RenderGeometry(renderer, NULL, rectBatch.vertices, rectBatch.count * 4,
+                     rectBatch.indices, rectBatch.count * 6);
+  drawCalls++;
+  rectBatch.count = 0;
+}
+
+// Queue every live particle as a small square in the rectangle batch, so
+// they go out with the rest of the frame's rectangles in flushRects().
+// Particles fade toward the black background as they age.
+void queueParticles() {
+  int n = particles.count;
+  if (n == 0) return;
+  if (rectBatch.count + n > rectBatch.capacity &&
+      !growRectBatch(rectBatch.count + n)) {
+    return;
+  }
+
+  SDL_Vertex *v = &rectBatch.vertices[rectBatch.count * 4];
+  for (int i = 0; i < n; i++, v += 4) {
+    float fade = particles.life[i] * (1.0f / PARTICLE_LIFETIME);
+    SDL_Color c = particles.color[i];
+    c.r = (Uint8)(c.r * fade);
+    c.g = (Uint8)(c.g * fade);
+    c.b = (Uint8)(c.b * fade);
+    float x0 = particles.x[i], y0 = particles.y[i];
+    float x1 = x0 + PARTICLE_SIZE, y1 = y0 + PARTICLE_SIZE;
+    v[0] = (SDL_Vertex){{x0, y0}, c, {0, 0}};
+    v[1] = (SDL_Vertex){{x1, y0}, c, {0, 0}};
+    v[2] = (SDL_Vertex){{x0, y1}, c, {0, 0}};
+    v[3] = (SDL_Vertex){{x1, y1}, c, {0, 0}};
+  }
+  rectBatch.count += n;
+}
+
+// Original per-pixel arc drawing, one point per covered pixel. Only used for
+// partial arcs when a sprite can't be made, and by the ball benchmark.
+void drawArcPoints(SDL_Renderer *renderer, struct Arc arc) {
+  SDL_SetRenderDrawColor(renderer, arc.color.r, arc.color.g, arc.color.b,
+                         arc.color.a);
+
+  for (int w = 0; w < arc.r * 2; w++) {
+    for (int h = 0; h < arc.r * 2; h++) {
+      int dx = arc.r - w;
+      int dy = arc.r - h;
+      double distanceSquared = dx * dx + dy * dy;
+
+      if (distanceSquared <= arc.r * arc.r) {
+        double angle = atan2(dy, dx);
+
+        if (angle < 0) {
+          angle += 2 * M_PI;
+        }
+
+        if (angle >= arc.startAngle && angle <= arc.endAngle) {
+          SDL_RenderDrawPoint(renderer, arc.x + dx, arc.y + dy);
+          ballDrawCalls++;
+          drawCalls++;
+        }
+      }
+    }
+  }
+
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+}
+
+// Check if an arc covers the whole circle, so no angle test is needed
+static inline bool isFullCircle(struct Arc arc) {
+  return arc.startAngle <= 0 && arc.endAngle >= 2 * M_PI;
+}
+
+// Half width of the circle's row at vertical offset dy, or -1 if the row
+// is outside the circle. Matches the per-pixel distance test exactly.
+static inline int circleSpan(int r, int dy) {
+  if (dy * dy > r * r) return -1;
+  int span = (int)sqrt((double)(r * r - dy * dy));
+  // Guard against sqrt rounding either way
+  while (span * span + dy * dy > r * r) span--;
+  while ((span + 1) * (span + 1) + dy * dy <= r * r) span++;
+  return span;
+}
+
+// Full circles without a sprite: one filled row per scanline
+void drawCircleSpans(SDL_Renderer *renderer, struct Arc arc) {
+  SDL_SetRenderDrawColor(renderer, arc.color.r, arc.color.g, arc.color.b,
+                         arc.color.a);
+
+  for (int dy = -arc.r + 1; dy <= arc.r; dy++) {
+    int span = circleSpan(arc.r, dy);
+    if (span < 0) continue;
+    // The per-pixel loop covers dx in (-r, r], so clip the left end
+    int left = (span >= arc.r) ? -arc.r + 1 : -span;
+    SDL_Rect row = {arc.x + left, arc.y + dy, span - left + 1, 1};
+    SDL_RenderFillRect(renderer, &row);
+    ballDrawCalls++;
+    drawCalls++;
+  }
+
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+}
+
+// Rasterize an arc into a sprite texture. Pixel (0, 0) of the sprite is the
+// screen offset (-r + 1, -r + 1) from the arc's center.
+SDL_Texture *rasterizeBallSprite(SDL_Renderer *renderer, struct Arc arc) {
+  int size = arc.r * 2;
+  SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+      0, size, size, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (surface == NULL) {
+    return NULL;
+  }
+
+  Uint32 pixel = SDL_MapRGBA(surface->format, arc.color.r, arc.color.g,
+                             arc.color.b, arc.color.a);
+  bool fullCircle = isFullCircle(arc);
+
+  SDL_LockSurface(surface);
+  for (int row = 0; row < size; row++) {
+    Uint32 *pixels = (Uint32 *)((Uint8 *)surface->pixels + row * surface->pitch);
+    int dy = row - arc.r + 1;
+
+    if (fullCircle) {
+      // Fast path: fill the row's span, no angle test at all
+      int span = circleSpan(arc.r, dy);
+      for (int col = 0; col < size; col++) {
+        int dx = col - arc.r + 1;
+        pixels[col] = (span >= 0 && dx >= -span && dx <= span) ? pixel : 0;
+      }
+      continue;
+    }
+
+    for (int col = 0; col < size; col++) {
+      int dx = col - arc.r + 1;
+      pixels[col] = 0;
+      if (dx * dx + dy * dy <= arc.r * arc.r) {
+        double angle = atan2(dy, dx);
+        if (angle < 0) {
+          angle += 2 * M_PI;
+        }
+        if (angle >= arc.startAngle && angle <= arc.endAngle) {
+          pixels[col] = pixel;
+        }
+      }
+    }
+  }
+  SDL_UnlockSurface(surface);
+
+  SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
+  SDL_FreeSurface(surface);
+  if (texture != NULL) {
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+  }
+  return texture;
+}
+
+// Find or make the sprite for an arc's radius, color and span
+SDL_Texture *getBallSprite(SDL_Renderer *renderer, struct Arc arc) {
+  for (int i = 0; i < MAX_BALL_SPRITES; i++) {
+    BallSprite *sprite = &ballSprites[i];
+    if (sprite->texture != NULL && sprite->r == arc.r &&
+        sprite->startAngle == arc.startAngle &&
+        sprite->endAngle == arc.endAngle &&
+        sprite->color.r == arc.color.r && sprite->color.g == arc.color.g &&
+        sprite->color.b == arc.color.b && sprite->color.a == arc.color.a) {
+      return sprite->texture;
+    }
+  }
+
+  SDL_Texture *texture = rasterizeBallSprite(renderer, arc);
+  if (texture == NULL) {
+    return NULL;
+  }
+
+  // Replace the oldest entry once the cache is full
+  BallSprite *sprite = &ballSprites[nextBallSprite];
+  nextBallSprite = (nextBallSprite + 1) % MAX_BALL_SPRITES;
+  if (sprite->texture != NULL) {
+    SDL_DestroyTexture(sprite->texture);
+  }
+  *sprite = (BallSprite){texture, arc.r, arc.startAngle, arc.endAngle,
+                         arc.color};
+  return texture;
+}
+
+// Release all cached ball sprites
+void freeBallSprites() {
+  for (int i = 0; i < MAX_BALL_SPRITES; i++) {
+    if (ballSprites[i].texture != NULL) {
+      SDL_DestroyTexture(ballSprites[i].texture);
+    }
+    ballSprites[i] = (BallSprite){0};
+  }
+  nextBallSprite = 0;
+}
+
+void drawArc(SDL_Renderer *renderer, struct Arc arc) {
+  SDL_Texture *sprite = getBallSprite(renderer, arc);
+  if (sprite != NULL) {
+    SDL_Rect dest = {arc.x - arc.r + 1, arc.y - arc.r + 1, arc.r * 2,
+                     arc.r * 2};
+    SDL_RenderCopy(renderer, sprite, NULL, &dest);
+    ballDrawCalls++;
+    drawCalls++;
+    return;
+  }
+
+  // No sprite available, draw straight to the renderer
+  if (isFullCircle(arc)) {
+    drawCircleSpans(renderer, arc);
+  } else {
+    drawArcPoints(renderer, arc);
+  }
+}
+
+// Draw every ball, alpha of the way from its previous tick to its current one
+void drawBalls(SDL_Renderer *renderer, float alpha) {
+  for (int i = 0; i < balls.count; i++) {
+    struct Arc ball = {
+        balls.prevX[i] + (balls.x[i] - balls.prevX[i]) * alpha,
+        balls.prevY[i] + (balls.y[i] - balls.prevY[i]) * alpha,
+        BALL_RADIUS, 0, M_PI * 2, {255, 0, 0, 255}};
+    drawArc(renderer, ball);
+  }
+}
+
+// Draw-call count and CPU time per ball for the old per-pixel drawing, the
+// span fallback and the cached sprite. Renders into an offscreen surface
+// so no window is needed.
+void benchmarkBallDrawing() {
+  const int radii[] = {10, 50};
+  const int balls = 2000;
+
+  SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(
+      0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+  SDL_Renderer *renderer =
+      target ? SDL_CreateSoftwareRenderer(target) : NULL;
+  if (renderer == NULL) {
+    printf("Could not create software renderer: %s\n", SDL_GetError());
+    SDL_FreeSurface(target);
+    return;
+  }
+
+  printf("%-6s %-8s %14s %14s\n", "radius", "method", "calls/ball",
+         "us/ball");
+  for (int r = 0; r < 2; r++) {
+    const char *names[] = {"points", "spans", "sprite"};
+    for (int method = 0; method < 3; method++) {
+      ballDrawCalls = 0;
+      Uint64 start = SDL_GetPerformanceCounter();
+      for (int i = 0; i < balls; i++) {
+        struct Arc arc = {60 + (i * 37) % (SCREEN_WIDTH - 120),
+                          60 + (i * 53) % (SCREEN_HEIGHT - 120), radii[r], 0,
+                          M_PI * 2, {255, 0, 0, 255}};
+        if (method == 0) drawArcPoints(renderer, arc);
+        else if (method == 1) drawCircleSpans(renderer, arc);
+        else drawArc(renderer, arc);
+      }
+      Uint64 ticks = SDL_GetPerformanceCounter() - start;
+      printf("%-6d %-8s %14.1f %14.3f\n", radii[r], names[method],
+             (double)ballDrawCalls / balls,
+             ticks * 1e6 / (double)SDL_GetPerformanceFrequency() / balls);
+    }
+  }
+
+  freeBallSprites();
+  SDL_DestroyRenderer(renderer);
+  SDL_FreeSurface(target);
+}
+
+// Draw calls and CPU time per frame for drawing the blocks one rectangle at
+// a time against the batch, at a normal level and a 10k brick layout.
+// Renders into an offscreen surface so no window is needed.
+void benchmarkRectDrawing() {
+  const int brickCounts[] = {70, 10000};
+  const int frames = 100;
+
+  SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(
+      0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+  SDL_Renderer *renderer =
+      target ? SDL_CreateSoftwareRenderer(target) : NULL;
+  if (renderer == NULL) {
+    printf("Could not create software renderer: %s\n", SDL_GetError());
+    SDL_FreeSurface(target);
+    return;
+  }
+
+  printf("%-8s %-8s %16s %14s\n", "bricks", "method", "draw calls/frame",
+         "ms/frame");
+  for (int c = 0; c < 2; c++) {
+    createBlocks(brickCounts[c]);
+    const char *names[] = {"single", "batched"};
+    for (int method = 0; method < 2; method++) {
+      drawCalls = 0;
+      Uint64 start = SDL_GetPerformanceCounter();
+      for (int f = 0; f < frames; f++) {
+        if (method == 0) {
+          // The old path: one color change and fill per block
+          for (int i = 0; i < blocks.count; i++) {
+            Rectangle block = {blocks.x[i], blocks.y[i], blocks.w[i],
+                               blocks.h[i], blocks.color[i]};
+            drawRectangle(renderer, block);
+          }
+        } else {
+          queueBlocks();
+          flushRects(renderer);
+        }
+      }
+      Uint64 ticks = SDL_GetPerformanceCounter() - start;
+      printf("%-8d %-8s %16.1f %14.3f\n", brickCounts[c], names[method],
+             (double)drawCalls / frames,
+             ticks * 1e3 / (double)SDL_GetPerformanceFrequency() / frames);
+    }
+  }
+  drawCalls = 0;
+
+  clearBlocks();
+  freeBlockStore();
+  freeRectBatch();
+  SDL_DestroyRenderer(renderer);
+  SDL_FreeSurface(target);
+}
+
+int checkCollision(struct Arc ball, Rectangle player) {
+  // Check if the ball's position is within the player's bounds horizontally
+  if (ball.x + ball.r > player.x && ball.x - ball.r < player.x + player.w) {
+    // Check if the ball's position is within the player's bounds vertically
+    if (ball.y + ball.r > player.y && ball.y - ball.r < player.y + player.h) {
+      return 1; // Collision detected
     }
   }
   return 0; // No collision
@@ -530,483 +1947,2301 @@ void makingBlock(Rectangle block[], int size) {
   int blockHeight = 20;
   int padding = 10;
 
-  for (int i = 0; i < size; i++) {
-    int blocksPerRow = SCREEN_WIDTH / (blockWidth + padding);
+  for (int i = 0; i < size; i++) {
+    int blocksPerRow = SCREEN_WIDTH / (blockWidth + padding);
+
+    block[i].x = (i % blocksPerRow) * (blockWidth + padding) + 5;
+    block[i].y = (i / blocksPerRow) * (blockHeight + padding);
+    block[i].w = blockWidth;
+    block[i].h = blockHeight;
+    block[i].color.r = rand() % 256;
+    block[i].color.g = rand() % 256;
+    block[i].color.b = rand() % 256;
+    block[i].color.a = 255;
+  }
+}
+
+// One ball hit on a block: damage it, and score and remove it once its
+// health runs out. The ball's bounce is up to the caller.
+void breakBlock(int hit) {
+  // Play block hit sound
+  playSound(SOUND_BLOCK_HIT);
+
+  // Decrease block health
+  blocks.health[hit]--;
+
+  // Update block color based on remaining health
+  switch (blocks.health[hit]) {
+    case 2:
+      blocks.color[hit] = (SDL_Color){255, 255, 0, 255};
+      break;
+    case 1:
+      blocks.color[hit] = (SDL_Color){0, 255, 0, 255};
+      break;
+  }
+
+  // Only remove block if health depleted
+  if (blocks.health[hit] <= 0) {
+    // Add score
+    score += blocks.scoreValue[hit];
+    totalBall--;
+
+    // Check if block drops a power-up
+    if (blocks.dropsPowerUp[hit]) {
+      addFallingPowerUp(blocks.x[hit] + blocks.w[hit]/2, 
+                       blocks.y[hit] + blocks.h[hit]/2,
+                       (PowerUpType)blocks.powerUpType[hit]);
+    }
+
+    // Shatter the block into particles of its color
+    createCollisionEffect(blocks.x[hit] + blocks.w[hit] / 2,
+                          blocks.y[hit] + blocks.h[hit] / 2, blocks.color[hit]);
+
+    // Remove the block from the grid and clear its live bit
+    gridRemoveBlock(hit);
+    blocks.liveMask[hit >> 6] &= ~((Uint64)1 << (hit & 63));
+  }
+}
+
+// Where a ball moving along a path first touches something: the fraction
+// of the path travelled and the contact normal, pointing back at the ball
+typedef struct {
+  float t;
+  float nx, ny;
+} SweepHit;
+
+// Swept circle against a box. Finds when a circle of radius r moving from
+// (px, py) by (dx, dy) first touches the box, as a fraction of the move.
+// The box grown by r is tested with slabs; a hit off the sides of the real
+// box is in a rounded corner and is tested against the corner's circle.
+// A circle already overlapping the box counts as touching at t = 0, with
+// the normal of the shallowest overlap. Only contacts the circle is moving
+// into count, so a ball that has just bounced off doesn't hit again.
+static bool sweepCircleBox(float px, float py, float dx, float dy, float r,
+                           float bx, float by, float bw, float bh,
+                           SweepHit *hit) {
+  float tEnter = -1e30f, tExit = 1e30f;
+  float nx = 0, ny = 0;
+
+  if (dx != 0) {
+    float t0 = (bx - r - px) / dx, t1 = (bx + bw + r - px) / dx;
+    float n = -1;
+    if (t0 > t1) {
+      float swap = t0; t0 = t1; t1 = swap;
+      n = 1;
+    }
+    if (t0 > tEnter) { tEnter = t0; nx = n; ny = 0; }
+    if (t1 < tExit) tExit = t1;
+  } else if (px <= bx - r || px >= bx + bw + r) {
+    return false;
+  }
+  if (dy != 0) {
+    float t0 = (by - r - py) / dy, t1 = (by + bh + r - py) / dy;
+    float n = -1;
+    if (t0 > t1) {
+      float swap = t0; t0 = t1; t1 = swap;
+      n = 1;
+    }
+    if (t0 > tEnter) { tEnter = t0; nx = 0; ny = n; }
+    if (t1 < tExit) tExit = t1;
+  } else if (py <= by - r || py >= by + bh + r) {
+    return false;
+  }
+  if (tEnter > tExit || tEnter > 1 || tExit <= 0) {
+    return false;
+  }
+
+  // Inside the grown box at the start: overlapping the box itself, or only
+  // within the square corner of the grown box, which is tested below
+  bool overlapping = false;
+  if (tEnter < -CONTACT_EPSILON) {
+    float nearX = fmaxf(bx, fminf(px, bx + bw));
+    float nearY = fmaxf(by, fminf(py, by + bh));
+    float distX = px - nearX, distY = py - nearY;
+    overlapping = distX * distX + distY * distY < r * r;
+  }
+
+  if (overlapping) {
+    // Already overlapping, push out along the shallowest axis
+    float overlapLeft = px + r - bx;
+    float overlapRight = bx + bw - (px - r);
+    float overlapTop = py + r - by;
+    float overlapBottom = by + bh - (py - r);
+    float minX = (overlapLeft < overlapRight) ? overlapLeft : overlapRight;
+    float minY = (overlapTop < overlapBottom) ? overlapTop : overlapBottom;
+    if (minX < minY) {
+      nx = (overlapLeft < overlapRight) ? -1 : 1;
+      ny = 0;
+    } else {
+      nx = 0;
+      ny = (overlapTop < overlapBottom) ? -1 : 1;
+    }
+    tEnter = 0;
+  } else {
+    if (tEnter < 0) tEnter = 0;
+    float hx = px + dx * tEnter, hy = py + dy * tEnter;
+    if ((hx < bx || hx > bx + bw) && (hy < by || hy > by + bh)) {
+      // Rounded corner: ray against the circle around the corner
+      float cx = (hx < bx) ? bx : bx + bw;
+      float cy = (hy < by) ? by : by + bh;
+      float fx = px - cx, fy = py - cy;
+      float a = dx * dx + dy * dy;
+      float b = fx * dx + fy * dy;
+      float c = fx * fx + fy * fy - r * r;
+      float discriminant = b * b - a * c;
+      if (discriminant < 0) {
+        return false;
+      }
+      tEnter = (-b - sqrtf(discriminant)) / a;
+      if (tEnter > 1 || tEnter < -CONTACT_EPSILON) {
+        return false;
+      }
+      if (tEnter < 0) tEnter = 0;
+      nx = (px + dx * tEnter - cx) / r;
+      ny = (py + dy * tEnter - cy) / r;
+    }
+  }
+
+  if (dx * nx + dy * ny >= 0) {
+    return false;
+  }
+  hit->t = tEnter;
+  hit->nx = nx;
+  hit->ny = ny;
+  return true;
+}
+
+// Things a ball can touch during a sweep
+typedef enum {
+  CONTACT_WALL,
+  CONTACT_PADDLE,
+  CONTACT_BLOCK
+} ContactKind;
+
+typedef struct {
+  ContactKind kind;
+  int block; // For CONTACT_BLOCK
+  SweepHit hit;
+} Contact;
+
+// Contacts tied for the earliest time of impact in one sweep step
+typedef struct {
+  Contact items[MAX_SIMULTANEOUS_CONTACTS];
+  int count;
+  float t;
+} ContactSet;
+
+// Keep a contact if it is the earliest so far or ties with it
+static void addContact(ContactSet *set, ContactKind kind, int block,
+                       SweepHit hit) {
+  if (hit.t < set->t - CONTACT_EPSILON) {
+    set->count = 0;
+    set->t = hit.t;
+  } else if (hit.t > set->t + CONTACT_EPSILON) {
+    return;
+  }
+  for (int i = 0; i < set->count; i++) {
+    if (set->items[i].kind == kind && set->items[i].block == block) {
+      return; // A block seen again through another grid cell
+    }
+  }
+  if (set->count < MAX_SIMULTANEOUS_CONTACTS) {
+    set->items[set->count++] = (Contact){kind, block, hit};
+  }
+}
+
+// Move one ball along its path for a fraction of the tick, bouncing off the
+// walls, the paddle and the blocks in the order it reaches them. Each step
+// finds the earliest time of impact on the rest of the path, moves the ball
+// there and resolves every contact tied for that time together, so a ball
+// hitting the seam between two blocks damages both and bounces once. A
+// ball never passes through anything however far it moves in a tick.
+void sweepBall(int i, Rectangle paddle, float fraction) {
+  float x = balls.x[i], y = balls.y[i];
+  float r = BALL_RADIUS;
+  float remaining = fraction;
+
+  for (int step = 0; step < MAX_BALL_CONTACTS && remaining > 0; step++) {
+    float dx = balls.vx[i] * tickScale * remaining;
+    float dy = balls.vy[i] * tickScale * remaining;
+    ContactSet contacts = {.count = 0, .t = 2.0f};
+    SweepHit hit;
+
+    // Walls, a plane each for the ball's center
+    if (dx < 0 && x + dx < r) {
+      hit = (SweepHit){x <= r ? 0 : (r - x) / dx, 1, 0};
+      addContact(&contacts, CONTACT_WALL, -1, hit);
+    }
+    if (dx > 0 && x + dx > SCREEN_WIDTH - r) {
+      hit = (SweepHit){x >= SCREEN_WIDTH - r ? 0 : (SCREEN_WIDTH - r - x) / dx,
+                       -1, 0};
+      addContact(&contacts, CONTACT_WALL, -1, hit);
+    }
+    if (dy < 0 && y + dy < r) {
+      hit = (SweepHit){y <= r ? 0 : (r - y) / dy, 0, 1};
+      addContact(&contacts, CONTACT_WALL, -1, hit);
+    }
+
+    // The paddle only catches balls coming down
+    if (dy > 0 && sweepCircleBox(x, y, dx, dy, r, paddle.x, paddle.y,
+                                 paddle.w, paddle.h, &hit)) {
+      addContact(&contacts, CONTACT_PADDLE, -1, hit);
+    }
+
+    // Blocks in the grid cells the path crosses
+    int col0, row0, col1, row1;
+    float left = (dx < 0 ? x + dx : x) - r, right = (dx < 0 ? x : x + dx) + r;
+    float top = (dy < 0 ? y + dy : y) - r, bottom = (dy < 0 ? y : y + dy) + r;
+    if (gridCellRange((int)floorf(left), (int)floorf(top), (int)ceilf(right),
+                      (int)ceilf(bottom), &col0, &row0, &col1, &row1)) {
+      for (int row = row0; row <= row1; row++) {
+        for (int col = col0; col <= col1; col++) {
+          int cell = row * blockGrid.cols + col;
+          int *items = &blockGrid.cellItems[blockGrid.cellStart[cell]];
+          for (int k = 0; k < blockGrid.cellCount[cell]; k++) {
+            int b = items[k];
+            if (sweepCircleBox(x, y, dx, dy, r, blocks.x[b], blocks.y[b],
+                               blocks.w[b], blocks.h[b], &hit)) {
+              addContact(&contacts, CONTACT_BLOCK, b, hit);
+            }
+          }
+        }
+      }
+    }
+
+    if (contacts.count == 0) {
+      x += dx;
+      y += dy;
+      break;
+    }
+
+    // Move up to the contact and resolve everything touched there
+    x += dx * contacts.t;
+    y += dy * contacts.t;
+    remaining *= 1.0f - contacts.t;
+    ballContacts += contacts.count;
+    for (int c = 0; c < contacts.count; c++) {
+      Contact contact = contacts.items[c];
+      float nx = contact.hit.nx, ny = contact.hit.ny;
+
+      if (contact.kind == CONTACT_PADDLE) {
+        // Play paddle hit sound
+        playSound(SOUND_PADDLE_HIT);
+
+        // Bounce up, angled by where the ball hits the paddle
+        float hitPosition = (x - paddle.x) / paddle.w;
+        balls.vy[i] = -ballSpeed;
+        balls.vx[i] = ballSpeed * (hitPosition - 0.5f) * 2; // -ballSpeed to +ballSpeed
+
+        // The headless bot picks a new spot to hit the ball with, otherwise
+        // it returns it straight up forever. The interactive auto paddle
+        // keeps tracking the ball dead center.
+        if (varyAutoAim) {
+          autoPaddleOffset = (gameRandom() % 81 - 40) / 100.0f * paddleWidth;
+        }
+
+        // Create visual effect
+        createCollisionEffect(x, y, (SDL_Color){100, 100, 255, 255});
+        continue;
+      }
+
+      // Walls and blocks reflect the ball on the axis the contact faces
+      // most, which keeps the speed on each axis as it was
+      if (fabsf(nx) >= fabsf(ny)) {
+        balls.vx[i] = (nx > 0) ? fabsf(balls.vx[i]) : -fabsf(balls.vx[i]);
+      } else {
+        balls.vy[i] = (ny > 0) ? fabsf(balls.vy[i]) : -fabsf(balls.vy[i]);
+      }
+      if (contact.kind == CONTACT_WALL) {
+        createCollisionEffect(x, y, (SDL_Color){255, 100, 100, 255});
+      } else {
+        breakBlock(contact.block);
+      }
+    }
+  }
+
+  balls.x[i] = x;
+  balls.y[i] = y;
+}
+
+// Compare a linear scan of the block store against the grid query for
+// growing layouts. Each "frame" is one collision query for a ball somewhere
+// over the layout.
+void benchmarkCollision() {
+  const int brickCounts[] = {70, 1000, 10000, 100000};
+  const int frames = 2000;
+
+  printf("%-8s %16s %16s %10s\n", "bricks", "linear us/frame",
+         "grid us/frame", "speedup");
+
+  for (int c = 0; c < 4; c++) {
+    createBlocks(brickCounts[c]);
+    int layoutHeight = blockGrid.rows * GRID_CELL_SIZE;
+
+    // Same pseudo-random ball positions for both runs
+    struct Arc *balls = (struct Arc *)malloc(frames * sizeof(struct Arc));
+    unsigned int seed = 12345;
+    for (int i = 0; i < frames; i++) {
+      seed = seed * 1103515245 + 12345;
+      balls[i].x = (seed >> 8) % SCREEN_WIDTH;
+      seed = seed * 1103515245 + 12345;
+      balls[i].y = (seed >> 8) % layoutHeight;
+      balls[i].r = 10;
+    }
+
+    int linearHits = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < frames; i++) {
+      struct Arc ball = balls[i];
+      for (int b = 0; b < blocks.count; b++) {
+        if (isBlockLive(b) && ball.x + ball.r > blocks.x[b] &&
+            ball.x - ball.r < blocks.x[b] + blocks.w[b] &&
+            ball.y + ball.r > blocks.y[b] &&
+            ball.y - ball.r < blocks.y[b] + blocks.h[b]) {
+          linearHits++;
+          break;
+        }
+      }
+    }
+    Uint64 linearTicks = SDL_GetPerformanceCounter() - start;
+
+    int gridHits = 0;
+    start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < frames; i++) {
+      if (gridFindCollision(balls[i]) >= 0) {
+        gridHits++;
+      }
+    }
+    Uint64 gridTicks = SDL_GetPerformanceCounter() - start;
+
+    double freq = (double)SDL_GetPerformanceFrequency();
+    double linearUs = linearTicks * 1e6 / freq / frames;
+    double gridUs = gridTicks * 1e6 / freq / frames;
+    printf("%-8d %16.3f %16.3f %9.1fx%s\n", brickCounts[c], linearUs, gridUs,
+           gridUs > 0 ? linearUs / gridUs : 0.0,
+           linearHits == gridHits ? "" : "  (hit count mismatch!)");
+
+    free(balls);
+  }
+
+  clearBlocks();
+  freeBlockStore();
+}
+
+// Node layout of the old malloc-per-block list, kept only so the block
+// store benchmark has something to compare against
+typedef struct ListBlockNode {
+  Rectangle block;
+  int health;
+  int scoreValue;
+  bool dropsPowerUp;
+  PowerUpType powerUpType;
+  struct ListBlockNode *next;
+} ListBlockNode;
+
+// Compare building, walking and tearing down a level with the block store
+// against the old linked list. The list is linked in shuffled allocation
+// order, which is what it looks like after a few levels of heap churn.
+void benchmarkBlockStore() {
+  const int brickCounts[] = {70, 1000, 10000, 100000};
+  const int passes = 200;
+  double freq = (double)SDL_GetPerformanceFrequency();
+
+  printf("%-8s %-6s %14s %14s %14s %12s\n", "bricks", "layout",
+         "build ns/blk", "walk ns/blk", "free ns/blk", "bytes/blk");
+
+  for (int c = 0; c < 4; c++) {
+    int count = brickCounts[c];
+    long checksum = 0;
+
+    // Linked list: one malloc per block, linked in shuffled order
+    Uint64 start = SDL_GetPerformanceCounter();
+    ListBlockNode **nodes =
+        (ListBlockNode **)malloc(count * sizeof(ListBlockNode *));
+    for (int i = 0; i < count; i++) {
+      nodes[i] = (ListBlockNode *)malloc(sizeof(ListBlockNode));
+      nodes[i]->block = (Rectangle){(i % 10) * 60 + 5, (i / 10) * 30, 50, 20,
+                                    {0, 255, 0, 255}};
+      nodes[i]->health = 1;
+      nodes[i]->scoreValue = 10;
+      nodes[i]->dropsPowerUp = false;
+      nodes[i]->powerUpType = POWER_NONE;
+    }
+    unsigned int seed = 12345;
+    for (int i = count - 1; i > 0; i--) {
+      seed = seed * 1103515245 + 12345;
+      int j = (seed >> 8) % (i + 1);
+      ListBlockNode *temp = nodes[i];
+      nodes[i] = nodes[j];
+      nodes[j] = temp;
+    }
+    for (int i = 0; i < count; i++) {
+      nodes[i]->next = (i + 1 < count) ? nodes[i + 1] : NULL;
+    }
+    ListBlockNode *head = nodes[0];
+    free(nodes);
+    Uint64 buildTicks = SDL_GetPerformanceCounter() - start;
+
+    // Walk the list the way the old drawBlocks() and breakBlock() did
+    start = SDL_GetPerformanceCounter();
+    for (int p = 0; p < passes; p++) {
+      for (ListBlockNode *node = head; node != NULL; node = node->next) {
+        checksum += node->block.x + node->block.y + node->health;
+      }
+    }
+    Uint64 walkTicks = SDL_GetPerformanceCounter() - start;
+
+    start = SDL_GetPerformanceCounter();
+    while (head != NULL) {
+      ListBlockNode *next = head->next;
+      free(head);
+      head = next;
+    }
+    Uint64 freeTicks = SDL_GetPerformanceCounter() - start;
+
+    printf("%-8d %-6s %14.2f %14.2f %14.2f %12d\n", count, "list",
+           buildTicks * 1e9 / freq / count,
+           walkTicks * 1e9 / freq / count / passes,
+           freeTicks * 1e9 / freq / count, (int)sizeof(ListBlockNode));
+
+    // Block store: one allocation, parallel arrays
+    start = SDL_GetPerformanceCounter();
+    createBlocks(count);
+    buildTicks = SDL_GetPerformanceCounter() - start;
+
+    start = SDL_GetPerformanceCounter();
+    for (int p = 0; p < passes; p++) {
+      for (int i = 0; i < blocks.count; i++) {
+        if (isBlockLive(i)) {
+          checksum += blocks.x[i] + blocks.y[i] + blocks.health[i];
+        }
+      }
+    }
+    walkTicks = SDL_GetPerformanceCounter() - start;
+
+    start = SDL_GetPerformanceCounter();
+    clearBlocks();
+    freeBlockStore();
+    freeTicks = SDL_GetPerformanceCounter() - start;
+
+    // Bytes a walk actually pulls in: x, y and health plus the live bit
+    printf("%-8d %-6s %14.2f %14.2f %14.2f %12.2f\n", count, "soa",
+           buildTicks * 1e9 / freq / count,
+           walkTicks * 1e9 / freq / count / passes,
+           freeTicks * 1e9 / freq / count, 3 * sizeof(int) + 1.0 / 8);
+
+    // Keep the walks from being optimized away
+    if (checksum == 42) printf(" ");
+  }
+
+  printf("(soa build also rolls power-ups and builds the collision grid)\n");
+}
+
+// Load times of a big level: the text format parsed and converted, against
+// the binary format mapped and copied into the block store. The grid build
+// that follows every load is timed on its own.
+void benchmarkLevels() {
+  const int count = 100000;
+  const int loads = 20;
+  const char *textPath = "bench_level.txt";
+  const char *binaryPath = "bench_level.brl";
+  double freq = (double)SDL_GetPerformanceFrequency();
+
+  // Write the layout out as text, with every column filled in
+  createBlocks(count);
+  FILE *file = fopen(textPath, "w");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to create %s\n", textPath);
+    return;
+  }
+  static const char *powerNames[POWER_TOTAL] = {"none",   "wider", "slower",
+                                                "faster", "multi", "life"};
+  Uint32 expected = 2166136261u;
+  for (int i = 0; i < count; i++) {
+    fprintf(file, "%d %d %d %d %d %s %d %d %d %d\n", blocks.x[i], blocks.y[i],
+            blocks.w[i], blocks.h[i], blocks.health[i],
+            powerNames[blocks.powerUpType[i]], blocks.scoreValue[i],
+            blocks.color[i].r, blocks.color[i].g, blocks.color[i].b);
+    expected = (expected ^ (Uint32)(blocks.x[i] + blocks.y[i] * 7 +
+                                    blocks.health[i] + blocks.powerUpType[i] +
+                                    blocks.color[i].g)) * 16777619u;
+  }
+  fclose(file);
+  clearBlocks();
+  freeBlockStore();
+
+  Uint64 start = SDL_GetPerformanceCounter();
+  bool ok = convertLevelFile(textPath, binaryPath);
+  double convertMs = (SDL_GetPerformanceCounter() - start) * 1e3 / freq;
+  if (!ok) return;
+
+  double loadMs = 0, bestMs = 1e9, gridMs = 0;
+  for (int l = 0; l < loads; l++) {
+    start = SDL_GetPerformanceCounter();
+    ok = loadLevelFile(binaryPath);
+    double ms = (SDL_GetPerformanceCounter() - start) * 1e3 / freq;
+    if (!ok) return;
+    loadMs += ms;
+    if (ms < bestMs) bestMs = ms;
+
+    start = SDL_GetPerformanceCounter();
+    buildBlockGrid();
+    gridMs += (SDL_GetPerformanceCounter() - start) * 1e3 / freq;
+  }
+
+  Uint32 loaded = 2166136261u;
+  for (int i = 0; i < blocks.count; i++) {
+    loaded = (loaded ^ (Uint32)(blocks.x[i] + blocks.y[i] * 7 +
+                                blocks.health[i] + blocks.powerUpType[i] +
+                                blocks.color[i].g)) * 16777619u;
+  }
+
+  printf("bricks: %d  binary size: %d bytes (%d per brick)\n", count,
+         LEVEL_HEADER_SIZE + count * LEVEL_BRICK_SIZE, LEVEL_BRICK_SIZE);
+  printf("text parse + convert: %8.2f ms\n", convertMs);
+  printf("binary load:          %8.2f ms average, %.2f ms best of %d\n",
+         loadMs / loads, bestMs, loads);
+  printf("  map + copy:         %8.2f ms\n", (loadMs - gridMs) / loads);
+  printf("  grid build:         %8.2f ms\n", gridMs / loads);
+  printf("round trip: %s\n", loaded == expected && blocks.count == count
+                                 ? "identical" : "MISMATCH");
+
+  clearBlocks();
+  freeBlockStore();
+  remove(textPath);
+  remove(binaryPath);
+}
+
+// Text rendering: the printable ASCII glyphs of the font are rasterized once
+// into a single atlas texture, and each string is drawn as a batch of
+// textured quads in one SDL_RenderGeometry call.
+#define GLYPH_FIRST 32
+#define GLYPH_LAST 126
+#define GLYPH_COUNT (GLYPH_LAST - GLYPH_FIRST + 1)
+#define ATLAS_WIDTH 512
+#define MAX_TEXT_LENGTH 128
+
+typedef struct {
+  SDL_Texture *texture;
+  int width, height;
+  SDL_Rect glyphs[GLYPH_COUNT]; // Where each glyph sits in the atlas
+  int advance[GLYPH_COUNT];     // How far the pen moves after each glyph
+} GlyphAtlas;
+
+GlyphAtlas textAtlas = {0};
+
+// Surfaces and textures created for text since startup. Once the atlas is
+// built this should stay flat while playing.
+int textAllocations = 0;
+bool showTextStats = false;
+
+// With --text-stats every heap allocation made through SDL's allocator is
+// counted as well. SDL_ttf uses it too, so a surface or texture created per
+// frame anywhere, not only where text code expects it, shows up here.
+SDL_atomic_t sdlHeapAllocations;
+SDL_malloc_func sdlMalloc;
+SDL_calloc_func sdlCalloc;
+SDL_realloc_func sdlRealloc;
+SDL_free_func sdlFree;
+
+void *countingMalloc(size_t size) {
+  SDL_AtomicAdd(&sdlHeapAllocations, 1);
+  return sdlMalloc(size);
+}
+
+void *countingCalloc(size_t count, size_t size) {
+  SDL_AtomicAdd(&sdlHeapAllocations, 1);
+  return sdlCalloc(count, size);
+}
+
+void *countingRealloc(void *memory, size_t size) {
+  SDL_AtomicAdd(&sdlHeapAllocations, 1);
+  return sdlRealloc(memory, size);
+}
+
+// Route SDL's allocations through the counters, before SDL allocates
+void countSdlAllocations() {
+  SDL_GetMemoryFunctions(&sdlMalloc, &sdlCalloc, &sdlRealloc, &sdlFree);
+  SDL_SetMemoryFunctions(countingMalloc, countingCalloc, countingRealloc,
+                         sdlFree);
+}
+
+// Every text surface and texture is created through these
+SDL_Surface *countTextSurface(SDL_Surface *surface) {
+  if (surface != NULL) textAllocations++;
+  return surface;
+}
+
+SDL_Texture *countTextTexture(SDL_Texture *texture) {
+  if (texture != NULL) textAllocations++;
+  return texture;
+}
+
+// Quads of a HUD line, only rebuilt when what it shows changes: the value,
+// or where and in which color it is drawn
+typedef struct {
+  const char *format; // printf format taking a single int
+  int value;
+  int x, y;
+  SDL_Color color;
+  bool valid;
+  int vertexCount;
+  SDL_Vertex vertices[MAX_TEXT_LENGTH * 4];
+} HudText;
+
+// Rasterize every printable glyph into the atlas texture
+bool buildGlyphAtlas(SDL_Renderer *renderer, TTF_Font *font) {
+  SDL_Color white = {255, 255, 255, 255};
+  SDL_Surface *glyphSurfaces[GLYPH_COUNT];
+
+  // Render the glyphs and pack them into rows
+  int penX = 0, penY = 0, rowHeight = 0;
+  for (int i = 0; i < GLYPH_COUNT; i++) {
+    Uint16 ch = GLYPH_FIRST + i;
+    glyphSurfaces[i] = countTextSurface(TTF_RenderGlyph_Blended(font, ch, white));
+
+    int advance = 0;
+    TTF_GlyphMetrics(font, ch, NULL, NULL, NULL, NULL, &advance);
+    textAtlas.advance[i] = advance;
+
+    int w = glyphSurfaces[i] ? glyphSurfaces[i]->w : 0;
+    int h = glyphSurfaces[i] ? glyphSurfaces[i]->h : 0;
+    if (penX + w > ATLAS_WIDTH) {
+      penX = 0;
+      penY += rowHeight;
+      rowHeight = 0;
+    }
+    textAtlas.glyphs[i] = (SDL_Rect){penX, penY, w, h};
+    penX += w;
+    if (h > rowHeight) rowHeight = h;
+  }
+
+  textAtlas.width = ATLAS_WIDTH;
+  textAtlas.height = penY + rowHeight;
+
+  SDL_Surface *atlas = countTextSurface(SDL_CreateRGBSurfaceWithFormat(
+      0, textAtlas.width, textAtlas.height, 32, SDL_PIXELFORMAT_ARGB8888));
+  if (atlas == NULL) {
+    printf("Failed to create glyph atlas: %s\n", SDL_GetError());
+    for (int i = 0; i < GLYPH_COUNT; i++) SDL_FreeSurface(glyphSurfaces[i]);
+    return false;
+  }
+
+  // Copy the glyphs in, keeping their alpha as is
+  for (int i = 0; i < GLYPH_COUNT; i++) {
+    if (glyphSurfaces[i] == NULL) continue;
+    SDL_SetSurfaceBlendMode(glyphSurfaces[i], SDL_BLENDMODE_NONE);
+    SDL_BlitSurface(glyphSurfaces[i], NULL, atlas, &textAtlas.glyphs[i]);
+    SDL_FreeSurface(glyphSurfaces[i]);
+  }
+
+  textAtlas.texture =
+      countTextTexture(SDL_CreateTextureFromSurface(renderer, atlas));
+  SDL_FreeSurface(atlas);
+  if (textAtlas.texture == NULL) {
+    printf("Failed to create texture: %s\n", SDL_GetError());
+    return false;
+  }
+  SDL_SetTextureBlendMode(textAtlas.texture, SDL_BLENDMODE_BLEND);
+  return true;
+}
+
+// Release the atlas texture
+void freeGlyphAtlas() {
+  if (textAtlas.texture != NULL) {
+    SDL_DestroyTexture(textAtlas.texture);
+  }
+  textAtlas = (GlyphAtlas){0};
+}
+
+// Build the quads for a string. Returns the number of vertices written.
+int layoutText(const char *text, SDL_Color color, int x, int y,
+               SDL_Vertex *vertices) {
+  float invW = 1.0f / textAtlas.width;
+  float invH = 1.0f / textAtlas.height;
+  int count = 0;
+  int penX = x;
+
+  for (int i = 0; text[i] != '\0' && i < MAX_TEXT_LENGTH; i++) {
+    int ch = (unsigned char)text[i];
+    if (ch < GLYPH_FIRST || ch > GLYPH_LAST) ch = '?';
+    int g = ch - GLYPH_FIRST;
+    SDL_Rect src = textAtlas.glyphs[g];
+
+    float x0 = penX, y0 = y, x1 = penX + src.w, y1 = y + src.h;
+    float u0 = src.x * invW, v0 = src.y * invH;
+    float u1 = (src.x + src.w) * invW, v1 = (src.y + src.h) * invH;
+    vertices[count++] = (SDL_Vertex){{x0, y0}, color, {u0, v0}};
+    vertices[count++] = (SDL_Vertex){{x1, y0}, color, {u1, v0}};
+    vertices[count++] = (SDL_Vertex){{x0, y1}, color, {u0, v1}};
+    vertices[count++] = (SDL_Vertex){{x1, y1}, color, {u1, v1}};
+
+    penX += textAtlas.advance[g];
+  }
+  return count;
+}
+
+// Submit prepared quads in a single call
+void drawTextVertices(SDL_Renderer *renderer, const SDL_Vertex *vertices,
+                      int vertexCount) {
+  // Two triangles per quad, same pattern for every glyph
+  static int indices[MAX_TEXT_LENGTH * 6];
+  static bool indicesReady = false;
+  if (!indicesReady) {
+    for (int q = 0; q < MAX_TEXT_LENGTH; q++) {
+      int base = q * 4;
+      int *tri = &indices[q * 6];
+      tri[0] = base; tri[1] = base + 1; tri[2] = base + 2;
+      tri[3] = base + 2; tri[4] = base + 1; tri[5] = base + 3;
+    }
+    indicesReady = true;
+  }
+
+  if (vertexCount == 0) return;
+  SDL_RenderGeometry(renderer, textAtlas.texture, vertices, vertexCount,
+                     indices, vertexCount / 4 * 6);
+  drawCalls++;
+}
+
+// Generic function to render text
+void renderText(SDL_Renderer *renderer, TTF_Font *font, const char *text, 
+                SDL_Color color, int x, int y) {
+  // Glyphs are rasterized on first use only
+  if (textAtlas.texture == NULL && !buildGlyphAtlas(renderer, font)) {
+    return;
+  }
+
+  SDL_Vertex vertices[MAX_TEXT_LENGTH * 4];
+  int vertexCount = layoutText(text, color, x, y, vertices);
+  drawTextVertices(renderer, vertices, vertexCount);
+}
+
+// Render a HUD value, laying the string out again only when it or its
+// position or color changed
+void renderHudText(SDL_Renderer *renderer, TTF_Font *font, HudText *hud,
+                   int value, SDL_Color color, int x, int y) {
+  if (textAtlas.texture == NULL && !buildGlyphAtlas(renderer, font)) {
+    return;
+  }
+
+  if (!hud->valid || hud->value != value || hud->x != x || hud->y != y ||
+      memcmp(&hud->color, &color, sizeof(SDL_Color)) != 0) {
+    char text[MAX_TEXT_LENGTH];
+    snprintf(text, sizeof(text), hud->format, value);
+    hud->vertexCount = layoutText(text, color, x, y, hud->vertices);
+    hud->value = value;
+    hud->x = x;
+    hud->y = y;
+    hud->color = color;
+    hud->valid = true;
+  }
+  drawTextVertices(renderer, hud->vertices, hud->vertexCount);
+}
+
+void renderWinMessage(SDL_Renderer *renderer, TTF_Font *font, char *condition) {
+  SDL_Color green = {0, 255, 0, 255};
+  renderText(renderer, font, condition, green, 
+             SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 - 15);
+}
+
+void renderScore(SDL_Renderer *renderer, TTF_Font *font, int score) {
+  static HudText scoreHud = {.format = "Score: %d"};
+  SDL_Color white = {255, 255, 255, 255};
+  renderHudText(renderer, font, &scoreHud, score, white, 10, SCREEN_HEIGHT - 25);
+}
+
+// Render high score
+void renderHighScore(SDL_Renderer *renderer, TTF_Font *font, int highScore) {
+  if (highScore <= 0) return;
+  
+  static HudText highScoreHud = {.format = "High Score: %d"};
+  SDL_Color gold = {255, 215, 0, 255}; // Gold color
+  renderHudText(renderer, font, &highScoreHud, highScore, gold,
+                SCREEN_WIDTH - 150, SCREEN_HEIGHT - 25);
+}
+
+// Render difficulty selection screen
+void renderDifficultyScreen(SDL_Renderer *renderer, TTF_Font *font) {
+  // Set background color (dark blue)
+  SDL_SetRenderDrawColor(renderer, 0, 0, 100, 255);
+  SDL_RenderClear(renderer);
+  
+  // Title
+  SDL_Color titleColor = {255, 255, 0, 255}; // Yellow
+  renderText(renderer, font, "SELECT DIFFICULTY", titleColor, SCREEN_WIDTH/2 - 120, 80);
+  
+  // Difficulty options
+  SDL_Color selected = {255, 255, 255, 255}; // White
+  SDL_Color unselected = {150, 150, 150, 255}; // Gray
+  
+  // Easy option
+  renderText(renderer, font, "Easy", 
+             (selectedDifficulty == DIFFICULTY_EASY) ? selected : unselected,
+             SCREEN_WIDTH/2 - 30, 160);
+  
+  // Medium option
+  renderText(renderer, font, "Medium", 
+             (selectedDifficulty == DIFFICULTY_MEDIUM) ? selected : unselected,
+             SCREEN_WIDTH/2 - 50, 200);
+  
+  // Hard option
+  renderText(renderer, font, "Hard", 
+             (selectedDifficulty == DIFFICULTY_HARD) ? selected : unselected,
+             SCREEN_WIDTH/2 - 30, 240);
+  
+  // Instructions
+  SDL_Color instructionColor = {200, 200, 200, 255}; // Light gray
+  renderText(renderer, font, "Up/Down: Select, Enter: Confirm, ESC: Back", 
+             instructionColor, SCREEN_WIDTH/2 - 200, SCREEN_HEIGHT - 60);
+}
+
+// Render the lobby screen with updated options
+void renderLobby(SDL_Renderer *renderer, TTF_Font *font) {
+  // Set background color (dark blue)
+  SDL_SetRenderDrawColor(renderer, 0, 0, 80, 255);
+  SDL_RenderClear(renderer);
+  
+  // Title
+  SDL_Color titleColor = {255, 255, 0, 255}; // Yellow
+  renderText(renderer, font, "BREAKOUT", titleColor, SCREEN_WIDTH/2 - 70, 80);
+  
+  // Menu options
+  SDL_Color selected = {255, 255, 255, 255}; // White
+  SDL_Color unselected = {150, 150, 150, 255}; // Gray
+  
+  // Start Game option
+  renderText(renderer, font, "Start Game", 
+             (selectedOption == MENU_START) ? selected : unselected,
+             SCREEN_WIDTH/2 - 70, 160);
+  
+  // Difficulty option
+  renderText(renderer, font, "Difficulty", 
+             (selectedOption == MENU_DIFFICULTY) ? selected : unselected,
+             SCREEN_WIDTH/2 - 60, 200);
+  
+  // Quit option
+  renderText(renderer, font, "Quit", 
+             (selectedOption == MENU_EXIT) ? selected : unselected,
+             SCREEN_WIDTH/2 - 30, 240);
+  
+  // Current difficulty display
+  char diffText[20];
+  switch(currentDifficulty) {
+    case DIFFICULTY_EASY:
+      sprintf(diffText, "Difficulty: Easy");
+      break;
+    case DIFFICULTY_MEDIUM:
+      sprintf(diffText, "Difficulty: Medium");
+      break;
+    case DIFFICULTY_HARD:
+      sprintf(diffText, "Difficulty: Hard");
+      break;
+    case DIFFICULTY_TOTAL:
+      // This should never happen, but needed for exhaustive switch
+      sprintf(diffText, "Difficulty: Unknown");
+      break;
+  }
+  renderText(renderer, font, diffText, unselected, SCREEN_WIDTH/2 - 80, 280);
+  
+  // Instructions
+  SDL_Color instructionColor = {200, 200, 200, 255}; // Light gray
+  renderText(renderer, font, "Up/Down: Select, Enter: Confirm", 
+             instructionColor, SCREEN_WIDTH/2 - 150, SCREEN_HEIGHT - 60);
+  
+  // Display high score if exists
+  renderHighScore(renderer, font, highScore);
+}
+
+// Render pause screen overlay
+void renderPauseScreen(SDL_Renderer *renderer, TTF_Font *font) {
+  // Semi-transparent overlay
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
+  SDL_Rect overlay = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+  SDL_RenderFillRect(renderer, &overlay);
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+  
+  // Pause message
+  SDL_Color white = {255, 255, 255, 255};
+  renderText(renderer, font, "PAUSED", white, SCREEN_WIDTH/2 - 60, SCREEN_HEIGHT/2 - 30);
+  
+  // Instructions
+  SDL_Color instructionColor = {200, 200, 200, 255};
+  renderText(renderer, font, "Press P to Resume, ESC for Menu", 
+             instructionColor, SCREEN_WIDTH/2 - 150, SCREEN_HEIGHT/2 + 20);
+}
+
+// Render game over screen
+void renderGameOverScreen(SDL_Renderer *renderer, TTF_Font *font, bool isWin) {
+  // Set background color (dark red for loss, dark green for win)
+  if (isWin) {
+    SDL_SetRenderDrawColor(renderer, 0, 50, 0, 255); // Dark green
+  } else {
+    SDL_SetRenderDrawColor(renderer, 50, 0, 0, 255); // Dark red
+  }
+  SDL_RenderClear(renderer);
+  
+  // Game result message
+  SDL_Color messageColor = isWin ? 
+                          (SDL_Color){0, 255, 0, 255} :  // Bright green
+                          (SDL_Color){255, 0, 0, 255};   // Bright red
+  
+  const char* message = isWin ? "YOU WIN!" : "GAME OVER";
+  renderText(renderer, font, message, messageColor, 
+            SCREEN_WIDTH / 2 - 70, SCREEN_HEIGHT / 2 - 40);
+  
+  // Score display
+  char scoreText[32];
+  sprintf(scoreText, "Your Score: %d", score);
+  SDL_Color white = {255, 255, 255, 255};
+  renderText(renderer, font, scoreText, white, SCREEN_WIDTH/2 - 80, SCREEN_HEIGHT/2);
+  
+  // New high score notification
+  if (score > highScore) {
+    highScore = score;
+    SDL_Color gold = {255, 215, 0, 255}; // Gold
+    renderText(renderer, font, "NEW HIGH SCORE!", gold, 
+              SCREEN_WIDTH/2 - 110, SCREEN_HEIGHT/2 + 30);
+  }
+  
+  // Instructions
+  SDL_Color instructionColor = {200, 200, 200, 255}; // Light gray
+  renderText(renderer, font, "Press R to restart or ESC for menu", 
+            instructionColor, SCREEN_WIDTH/2 - 160, SCREEN_HEIGHT - 60);
+}
+
+// Startup timing. Phases run on the main thread and on the asset loader at
+// the same time, so each records when it started and ended, in milliseconds
+// since launch, rather than just how long it took.
+#define MAX_STARTUP_PHASES 16
+
+typedef struct {
+  const char *name;
+  const char *thread;
+  double start, end;
+} StartupPhase;
+
+StartupPhase startupPhases[MAX_STARTUP_PHASES];
+SDL_atomic_t startupPhaseCount;
+Uint64 launchCounter; // Performance counter at the top of main()
+bool showStartupStats = false;
+
+double msSinceLaunch() {
+  return (SDL_GetPerformanceCounter() - launchCounter) * 1000.0 /
+         SDL_GetPerformanceFrequency();
+}
+
+// Start timing a phase, returns the handle for endStartupPhase()
+int beginStartupPhase(const char *name, const char *thread) {
+  int phase = SDL_AtomicAdd(&startupPhaseCount, 1);
+  if (phase >= MAX_STARTUP_PHASES) return -1;
+  startupPhases[phase] = (StartupPhase){name, thread, msSinceLaunch(), 0};
+  return phase;
+}
+
+void endStartupPhase(int phase) {
+  if (phase >= 0) startupPhases[phase].end = msSinceLaunch();
+}
+
+// Print every phase in the order it started, plus the two milestones
+void printStartupReport(double firstFrameMs, double soundsReadyMs) {
+  int count = SDL_AtomicGet(&startupPhaseCount);
+  if (count > MAX_STARTUP_PHASES) count = MAX_STARTUP_PHASES;
+
+  printf("%-8s %-16s %9s %9s %9s\n", "thread", "phase", "start ms",
+         "end ms", "took ms");
+  for (int i = 0; i < count; i++) {
+    StartupPhase *phase = &startupPhases[i];
+    printf("%-8s %-16s %9.2f %9.2f %9.2f\n", phase->thread, phase->name,
+           phase->start, phase->end, phase->end - phase->start);
+  }
+  printf("time to first frame: %.2f ms\n", firstFrameMs);
+  printf("sounds ready:        %.2f ms\n", soundsReadyMs);
+}
+
+// Start a voice for a queued event. A sound at its voice limit restarts its
+// own copy that is furthest along; with every voice busy the voice furthest
+// along overall is stolen, it's the one closest to finishing anyway.
+void startVoice(SfxEvent event, Uint64 now) {
+  Mix_Chunk *chunk = sounds[event.sound];
+  if (chunk == NULL) return;
+
+  int same = 0, oldestSame = -1, oldest = -1;
+  for (int i = 0; i < voiceCount; i++) {
+    if (oldest < 0 || voices[i].position > voices[oldest].position) {
+      oldest = i;
+    }
+    if (voices[i].sound == event.sound) {
+      same++;
+      if (oldestSame < 0 || voices[i].position > voices[oldestSame].position) {
+        oldestSame = i;
+      }
+    }
+  }
+
+  int slot;
+  if (same > 0 && same >= soundVoiceLimit[event.sound]) {
+    slot = oldestSame;
+    audioStats.stolen++;
+  } else if (voiceCount == MAX_VOICES) {
+    slot = oldest;
+    audioStats.stolen++;
+  } else {
+    slot = voiceCount++;
+  }
+  voices[slot] = (Voice){event.sound, 0, chunk->alen / sizeof(Sint16)};
+
+  audioStats.played++;
+  if (voiceCount > audioStats.peakVoices) audioStats.peakVoices = voiceCount;
+  Uint64 latency = now - event.pushedAt;
+  audioStats.latencyTicks += latency;
+  if (latency > audioStats.maxLatencyTicks) audioStats.maxLatencyTicks = latency;
+}
+
+// Drain the event queue and mix the voices into one device buffer of
+// interleaved 16-bit stereo, on top of whatever SDL_mixer put there
+void mixSoundEffectsAt(Sint16 *out, int samples, Uint64 now) {
+  Uint64 start = SDL_GetPerformanceCounter();
+
+  int tail = SDL_AtomicGet(&sfxQueue.tail);
+  int head = SDL_AtomicGet(&sfxQueue.head);
+  for (; tail != head; tail++) {
+    startVoice(sfxQueue.events[tail & (SFX_QUEUE_SIZE - 1)], now);
+  }
+  SDL_AtomicSet(&sfxQueue.tail, tail); // Hands the slots back
+
+  Sint32 mix[MIX_BLOCK];
+  for (int offset = 0; offset < samples && voiceCount > 0; offset += MIX_BLOCK) {
+    int n = samples - offset < MIX_BLOCK ? samples - offset : MIX_BLOCK;
+    for (int i = 0; i < n; i++) {
+      mix[i] = out[offset + i];
+    }
+
+    // Backwards, so a finished voice can be swapped with the last one
+    for (int v = voiceCount - 1; v >= 0; v--) {
+      Voice *voice = &voices[v];
+      Mix_Chunk *chunk = sounds[voice->sound];
+      const Sint16 *source = (const Sint16 *)chunk->abuf + voice->position;
+      int volume = chunk->volume;
+      int m = voice->length - voice->position;
+      if (m > n) m = n;
+      for (int i = 0; i < m; i++) {
+        mix[i] += (source[i] * volume) >> 7; // MIX_MAX_VOLUME is 128
+      }
+      voice->position += m;
+      if (voice->position >= voice->length) {
+        voices[v] = voices[--voiceCount];
+      }
+    }
+
+    for (int i = 0; i < n; i++) {
+      Sint32 sample = mix[i];
+      out[offset + i] = sample > 32767 ? 32767 : sample < -32768 ? -32768 : sample;
+    }
+  }
+
+  Uint64 ticks = SDL_GetPerformanceCounter() - start;
+  audioStats.callbacks++;
+  audioStats.callbackTicks += ticks;
+  if (ticks > audioStats.maxCallbackTicks) audioStats.maxCallbackTicks = ticks;
+}
+
+// SDL_mixer post-mix callback, runs on the audio thread
+void mixSoundEffects(void *data, Uint8 *stream, int length) {
+  (void)data;
+  mixSoundEffectsAt((Sint16 *)stream, length / sizeof(Sint16),
+                    SDL_GetPerformanceCounter());
+}
+
+// Report the counters. A mixed buffer starts playing about one buffer after
+// the callback filled it, so that is added for the event-to-output estimate;
+// latency inside the driver and the hardware isn't visible from here.
+void printAudioStats() {
+  double freq = (double)SDL_GetPerformanceFrequency();
+  double bufferMs = audioBufferSize * 1000.0 / audioFrequency;
+  Uint64 callbacks = audioStats.callbacks > 0 ? audioStats.callbacks : 1;
+  int played = audioStats.played > 0 ? audioStats.played : 1;
+  double callbackUs = audioStats.callbackTicks * 1e6 / freq / callbacks;
+  double latencyMs = audioStats.latencyTicks * 1e3 / freq / played;
+
+  printf("audio buffer: %d frames at %d Hz (%.2f ms)\n", audioBufferSize,
+         audioFrequency, bufferMs);
+  printf("callback: %llu calls, %.2f us average, %.2f us max (%.2f%% of a buffer)\n",
+         (unsigned long long)audioStats.callbacks, callbackUs,
+         audioStats.maxCallbackTicks * 1e6 / freq,
+         callbackUs / (bufferMs * 10.0));
+  printf("event to mix: %.2f ms average, %.2f ms max; to output ~%.2f ms\n",
+         latencyMs, audioStats.maxLatencyTicks * 1e3 / freq,
+         latencyMs + bufferMs);
+  printf("voices: %d played, peak %d of %d, %d stolen; events: %d coalesced, %d dropped\n",
+         audioStats.played, audioStats.peakVoices, MAX_VOICES, audioStats.stolen,
+         audioStats.coalesced, audioStats.dropped);
+}
+
+// Run the mixer on synthetic sounds without an audio device: 10 seconds of
+// a busy multi-ball game at 60 frames a second, with the callback driven on
+// a simulated clock for each buffer size. Callback CPU time is real, the
+// latencies come from the simulated clock.
+void benchmarkAudio() {
+  const int bufferSizes[] = {256, 512, 1024, 2048};
+  const int frames = 600;
+  const int lengthsMs[MAX_SOUNDS] = {80, 150, 400, 1500, 1500, 60, 90};
+  double freq = (double)SDL_GetPerformanceFrequency();
+
+  // Sawtooth chunks of the usual lengths, in the device format
+  for (int s = 0; s < MAX_SOUNDS; s++) {
+    if (lengthsMs[s] == 0) continue;
+    sounds[s] = (Mix_Chunk *)calloc(1, sizeof(Mix_Chunk));
+    sounds[s]->alen = audioFrequency * lengthsMs[s] / 1000 * 2 * sizeof(Sint16);
+    sounds[s]->abuf = (Uint8 *)malloc(sounds[s]->alen);
+    sounds[s]->volume = MIX_MAX_VOLUME;
+    Sint16 *samples = (Sint16 *)sounds[s]->abuf;
+    for (Uint32 i = 0; i < sounds[s]->alen / sizeof(Sint16); i++) {
+      samples[i] = (Sint16)((i * (97 + s * 31)) % 16384 - 8192);
+    }
+  }
+  customMixer = true;
+  sound_enabled = true;
+
+  printf("%-7s %9s %12s %12s %9s %12s %12s %7s %9s\n", "buffer", "ms",
+         "cb us avg", "cb us max", "cb %", "to mix ms", "to out ms",
+         "stolen", "coalesced");
+
+  // The first pass only warms up the chunks and isn't printed
+  Sint16 *buffer = (Sint16 *)malloc(2048 * 2 * sizeof(Sint16));
+  for (int b = -1; b < 4; b++) {
+    audioBufferSize = bufferSizes[b < 0 ? 0 : b];
+    audioStats = (AudioStats){0};
+    voiceCount = 0;
+    SDL_AtomicSet(&sfxQueue.tail, SDL_AtomicGet(&sfxQueue.head));
+    Uint32 random = 2463534242u;
+    double bufferTicks = audioBufferSize * freq / audioFrequency;
+    double nextCallback = 0;
+
+    for (int frame = 0; frame < frames; frame++) {
+      double frameTime = frame * freq / 60.0;
+      while (nextCallback <= frameTime) {
+        memset(buffer, 0, audioBufferSize * 2 * sizeof(Sint16));
+        mixSoundEffectsAt(buffer, audioBufferSize * 2, (Uint64)nextCallback);
+        nextCallback += bufferTicks;
+      }
+
+      // Every frame some blocks break, several at once in a burst; paddle
+      // hits, power-ups and menu noise now and then
+      beginSoundFrame();
+      random ^= random << 13;
+      random ^= random >> 17;
+      random ^= random << 5;
+      int hits = random % 6;
+      for (int h = 0; h < hits; h++) queueSound(SOUND_BLOCK_HIT, (Uint64)frameTime);
+      if (random % 4 == 0) queueSound(SOUND_PADDLE_HIT, (Uint64)frameTime);
+      if (random % 20 == 0) queueSound(SOUND_POWER_UP, (Uint64)frameTime);
+      if (random % 50 == 0) queueSound(SOUND_MENU_SELECT, (Uint64)frameTime);
+    }
+
+    if (b < 0) continue;
+    double callbackUs = audioStats.callbackTicks * 1e6 / freq / audioStats.callbacks;
+    double bufferMs = audioBufferSize * 1000.0 / audioFrequency;
+    double toMixMs = audioStats.latencyTicks * 1e3 / freq / audioStats.played;
+    printf("%-7d %9.2f %12.2f %12.2f %8.2f%% %12.2f %12.2f %7d %9d\n",
+           audioBufferSize, bufferMs, callbackUs,
+           audioStats.maxCallbackTicks * 1e6 / freq,
+           callbackUs / (bufferMs * 10.0), toMixMs, toMixMs + bufferMs,
+           audioStats.stolen, audioStats.coalesced);
+  }
+  printf("(peak voices %d of %d; to out adds one buffer of playback)\n",
+         audioStats.peakVoices, MAX_VOICES);
+
+  free(buffer);
+  for (int s = 0; s < MAX_SOUNDS; s++) {
+    if (sounds[s] != NULL) {
+      free(sounds[s]->abuf);
+      free(sounds[s]);
+      sounds[s] = NULL;
+    }
+  }
+  sound_enabled = false;
+}
+
+// Load and initialize sound effects. Runs on the asset loader thread, so it
+// leaves sound_enabled alone: the game loop switches sound on once the
+// loader is done. Returns whether any sound could be loaded.
+bool initSounds() {
+    // Initialize all sound pointers to NULL
+    for (int i = 0; i < MAX_SOUNDS; i++) {
+        sounds[i] = NULL;
+    }
+    
+    // Try to initialize SDL_mixer. The audio subsystem itself was brought
+    // up on the main thread, SDL wants subsystem init there.
+    int phase = beginStartupPhase("open audio", "loader");
+    bool opened = audioInitialized &&
+                  Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, audioBufferSize) == 0;
+    endStartupPhase(phase);
+    if (!opened) {
+        printf("SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError());
+        printf("Sound will be disabled.\n");
+        return false;
+    }
+
+    // Mix the effects ourselves when the device takes 16-bit stereo,
+    // which is what the loaded chunks get converted to
+    Uint16 format = 0;
+    int channels = 0;
+    Mix_QuerySpec(&audioFrequency, &format, &channels);
+    customMixer = format == AUDIO_S16SYS && channels == 2;
+    if (customMixer) {
+        Mix_SetPostMix(mixSoundEffects, NULL);
+    }
+    
+    // Load sound effects
+    bool all_sounds_loaded = true;
+    int sounds_loaded = 0;
+    
+    phase = beginStartupPhase("load sounds", "loader");
+    for (int i = 0; i < MAX_SOUNDS; i++) {
+        sounds[i] = Mix_LoadWAV(sound_files[i]);
+        if (sounds[i] == NULL) {
+            printf("Warning: Could not load sound file: %s\n", sound_files[i]);
+            all_sounds_loaded = false;
+        } else {
+            sounds_loaded++;
+        }
+    }
+    
+    endStartupPhase(phase);
+    
+    if (sounds_loaded == 0) {
+        printf("No sound files could be loaded. Sound will be disabled.\n");
+        printf("To enable sound, place WAV files in the 'sounds' directory.\n");
+        return false;
+    } else if (!all_sounds_loaded) {
+        printf("Some sound files were missing. Partial sound support enabled.\n");
+        printf("Loaded %d of %d sound files.\n", sounds_loaded, MAX_SOUNDS);
+    } else {
+        printf("All sound files loaded successfully.\n");
+    }
+    
+    return true;
+}
+
+// Clean up sound resources
+void cleanupSounds() {
+    // Stop our mixing before the chunks its voices point into are freed
+    if (customMixer) {
+        Mix_SetPostMix(NULL, NULL);
+    }
+
+    for (int i = 0; i < MAX_SOUNDS; i++) {
+        if (sounds[i] != NULL) {
+            Mix_FreeChunk(sounds[i]);
+            sounds[i] = NULL;
+        }
+    }
+    
+    Mix_CloseAudio();
+
+    // The callback is gone, its counters can be read now
+    if (showAudioStats && customMixer) {
+        printAudioStats();
+    }
+}
+
+// Assets are loaded on a worker thread while the main thread brings up the
+// window. The font is needed for the first frame and is handed over through
+// a semaphore; the sounds are picked up by the game loop whenever they are
+// done, the lobby works without them until then.
+typedef struct {
+  SDL_Thread *thread;
+  SDL_sem *fontReady;    // Posted once the font load has been attempted
+  SDL_atomic_t finished; // Set once the sounds are loaded as well
+  TTF_Font *font;
+  bool soundsLoaded;
+  double readyMs; // When the game loop picked the sounds up
+} AssetLoader;
+
+AssetLoader assetLoader = {0};
+
+int loadAssets(void *data) {
+  (void)data;
+
+  int phase = beginStartupPhase("open font", "loader");
+  assetLoader.font = TTF_OpenFont("Arial.ttf", 24);
+  endStartupPhase(phase);
+  SDL_SemPost(assetLoader.fontReady);
+
+  assetLoader.soundsLoaded = initSounds();
+  SDL_AtomicSet(&assetLoader.finished, 1);
+  return 0;
+}
+
+// Start loading assets in the background
+bool startAssetLoader() {
+  assetLoader.fontReady = SDL_CreateSemaphore(0);
+  if (assetLoader.fontReady == NULL) {
+    return false;
+  }
+  assetLoader.thread = SDL_CreateThread(loadAssets, "assets", NULL);
+  return assetLoader.thread != NULL;
+}
+
+// Block until the font is loaded, NULL if it failed to load
+TTF_Font *waitForFont() {
+  SDL_SemWait(assetLoader.fontReady);
+  return assetLoader.font;
+}
+
+// Switch sound on once the loader is done. With wait set, blocks until
+// then, which shutdown needs before the sounds can be freed.
+void pollAssetLoader(bool wait) {
+  if (assetLoader.thread == NULL ||
+      (!wait && !SDL_AtomicGet(&assetLoader.finished))) {
+    return;
+  }
+  SDL_WaitThread(assetLoader.thread, NULL);
+  assetLoader.thread = NULL;
+  SDL_DestroySemaphore(assetLoader.fontReady);
+  assetLoader.fontReady = NULL;
+  assetLoader.readyMs = msSinceLaunch();
+
+  sound_enabled = assetLoader.soundsLoaded;
+  if (!sound_enabled) {
+    printf("Warning: Sound initialization failed. Continuing without sound.\n");
+  }
+}
+
+// Apply difficulty settings
+void applyDifficultySettings() {
+    switch(currentDifficulty) {
+        case DIFFICULTY_EASY:
+            lives = 5;
+            ballSpeed = normalBallSpeed * 0.8f;
+            break;
+        case DIFFICULTY_MEDIUM:
+            lives = 3;
+            ballSpeed = normalBallSpeed;
+            break;
+        case DIFFICULTY_HARD:
+            lives = 2;
+            ballSpeed = normalBallSpeed * 1.2f;
+            break;
+        case DIFFICULTY_TOTAL:
+            // This should never happen, but needed for exhaustive switch
+            lives = 3;
+            ballSpeed = normalBallSpeed;
+            break;
+    }
+    
+    // Update ball velocity
+    setBallSpeed(ballSpeed);
+}
+
+// Number of blocks in a generated level
+int levelBlockCount(int level) {
+    // Adjust difficulty based on level
+    int blockCount = 35 + (level - 1) * 5; // More blocks in higher levels
+    return (blockCount > 70) ? 70 : blockCount; // Cap at 70 blocks
+}
+
+// Number of levels to clear before the game is won
+int levelCount() {
+    return levelFileCount > 0 ? levelFileCount : PROCEDURAL_LEVELS;
+}
+
+// Initialize level with appropriate number of blocks and layout
+void initializeLevel(int level) {
+    totalBall = levelBlockCount(level);
+    currentLevel = level;
+    
+    // Reset power-ups
+    initPowerUps();
+    
+    // Reset paddle
+    paddleWidth = 90;
+}
+
+// Remember where things were at the start of a tick, for interpolation
+void saveTickState() {
+  memcpy(balls.prevX, balls.x, balls.count * sizeof(float));
+  memcpy(balls.prevY, balls.y, balls.count * sizeof(float));
+  prevPlayer_X = player_X;
+}
+
+// Drop interpolation after a teleport so the ball doesn't smear across
+void snapInterpolation() {
+  saveTickState();
+}
+
+// Lay out a level's blocks: from its file when playing a level list,
+// generated otherwise or when the file fails to load
+void loadLevelBlocks(int level) {
+  currentLevel = level;
+  if (levelFileCount > 0 && loadLevelFile(levelFiles[level - 1])) {
+    totalBall = blocks.count;
+    return;
+  }
+  totalBall = levelBlockCount(level);
+  createBlocks(totalBall);
+}
+
+// Move on to the next level, keeping score, lives and running power-ups.
+// The ball is served from the paddle again.
+void advanceLevel() {
+  loadLevelBlocks(currentLevel + 1);
+
+  balls.count = 0;
+  addBall(player_X + (paddleWidth / 2), player_Y - 15, ballSpeed, ballSpeed);
+  ballLaunched = false;
+  snapInterpolation();
+}
+
+// Reset game to initial state
+void resetGame() {
+  // Reset player
+  player_X = SCREEN_WIDTH / 2 - 20;
+  player_Y = SCREEN_HEIGHT - (20 * 3);
+  player_vx = 0;
+  player_vy = 0;
+  
+  // Back to a single ball
+  balls.count = 0;
+  addBall(SCREEN_WIDTH / 2 - 10, SCREEN_HEIGHT / 2 - 10, 0, 0);
+  
+  // Apply difficulty settings
+  applyDifficultySettings();
+  
+  // Reset game variables
+  score = 0;
+  ballLaunched = false;
+  paused = false;
+  
+  // Initialize ball velocity (moved from global initialization)
+  balls.vx[0] = ballSpeed;
+  balls.vy[0] = ballSpeed;
+  
+  // Initialize level 1
+  initializeLevel(1);
+  
+  // Initialize power-ups
+  initPowerUps();
+
+  // Nothing to blend from yet
+  snapInterpolation();
+  
+  // Switch to playing state
+  currentState = STATE_PLAYING;
+}
 
-    block[i].x = (i % blocksPerRow) * (blockWidth + padding) + 5;
-    block[i].y = (i / blocksPerRow) * (blockHeight + padding);
-    block[i].w = blockWidth;
-    block[i].h = blockHeight;
-    block[i].color.r = rand() % 256;
-    block[i].color.g = rand() % 256;
-    block[i].color.b = rand() % 256;
-    block[i].color.a = 255;
+// Launch the ball from the paddle if it is still sitting there
+void launchBall() {
+  if (!ballLaunched) {
+    ballLaunched = true;
+    
+    // Set initial ball velocity
+    balls.vx[0] = ballSpeed;
+    balls.vy[0] = -ballSpeed; // Start going up
   }
 }
 
-// Handle block collision with updated health system
-void breakBlock(struct Arc ball, BlockNode **head) {
-  BlockNode *current = *head;
-  BlockNode *prev = NULL;
+// Little endian Uint32 in a recording
+void writeUint32(Uint8 *bytes, Uint32 value) {
+  bytes[0] = value & 0xff;
+  bytes[1] = (value >> 8) & 0xff;
+  bytes[2] = (value >> 16) & 0xff;
+  bytes[3] = value >> 24;
+}
 
-  while (current != NULL) {
-    Rectangle blk = current->block;
-    // Simple AABB (Axis-Aligned Bounding Box) collision
-    if (ball.x + ball.r > blk.x && ball.x - ball.r < blk.x + blk.w &&
-        ball.y + ball.r > blk.y && ball.y - ball.r < blk.y + blk.h) {
+Uint32 readUint32(const Uint8 *bytes) {
+  return (Uint32)bytes[0] | ((Uint32)bytes[1] << 8) |
+         ((Uint32)bytes[2] << 16) | ((Uint32)bytes[3] << 24);
+}
 
-      // Collision detected - change ball direction
-      // Determine if hit was from top/bottom or sides
-      float overlapLeft = ball.x + ball.r - blk.x;
-      float overlapRight = blk.x + blk.w - (ball.x - ball.r);
-      float overlapTop = ball.y + ball.r - blk.y;
-      float overlapBottom = blk.y + blk.h - (ball.y - ball.r);
+// Write one run of identical tick inputs: run length (2 bytes), buttons
+// (1 byte) and mouse X (2 bytes), all little endian
+void writeInputRun(FILE *file, TickInput input, int run) {
+  Uint8 bytes[5] = {run & 0xff, (run >> 8) & 0xff, input.buttons,
+                    (Uint16)input.mouseX & 0xff, ((Uint16)input.mouseX >> 8) & 0xff};
+  fwrite(bytes, 1, sizeof(bytes), file);
+}
 
-      // Find smallest overlap to determine direction
-      float minOverlapX = (overlapLeft < overlapRight) ? overlapLeft : overlapRight;
-      float minOverlapY = (overlapTop < overlapBottom) ? overlapTop : overlapBottom;
+// Flush and close the current recording
+void finishRecording() {
+  if (recordFile == NULL) return;
+  if (recordRun > 0) {
+    writeInputRun(recordFile, recordLast, recordRun);
+  }
+  fclose(recordFile);
+  recordFile = NULL;
+  recordRun = 0;
+}
 
-      // Change ball direction based on collision side
-      if (minOverlapX < minOverlapY) {
-        // Hit from left or right
-        ball_vx = -ball_vx;
-      } else {
-        // Hit from top or bottom
-        ball_vy = -ball_vy;
-      }
-      
-      // Play block hit sound if sound is enabled
-      if (sound_enabled && sounds[SOUND_BLOCK_HIT] != NULL) {
-          Mix_PlayChannel(-1, sounds[SOUND_BLOCK_HIT], 0);
-      }
+// Start recording a game, replacing whatever the file held before
+void startRecording(Uint32 seed) {
+  finishRecording();
+  recordFile = fopen(recordPath, "wb");
+  if (recordFile == NULL) {
+    printf("Could not open %s for recording\n", recordPath);
+    return;
+  }
 
-      // Decrease block health
-      current->health--;
-      
-      // Update block color based on remaining health
-      switch (current->health) {
-        case 2:
-          current->block.color.r = 255;
-          current->block.color.g = 255;
-          current->block.color.b = 0;
-          break;
-        case 1:
-          current->block.color.r = 0;
-          current->block.color.g = 255;
-          current->block.color.b = 0;
-          break;
-      }
-      
-      // Only remove block if health depleted
-      if (current->health <= 0) {
-        // Add score
-        score += current->scoreValue;
-        totalBall--;
-        
-        // Check if block drops a power-up
-        if (current->dropsPowerUp) {
-          addFallingPowerUp(current->block.x + current->block.w/2, 
-                           current->block.y + current->block.h/2,
-                           current->powerUpType);
-        }
-        
-        // Remove the block
-        if (prev == NULL) {
-          *head = current->next;
-        } else {
-          prev->next = current->next;
-        }
-        BlockNode *temp = current;
-        current = current->next;
-        free(temp);
-      } else {
-        prev = current;
-        current = current->next;
-      }
-      
-      return; // Process one collision per frame
-    } else {
-      prev = current;
-      current = current->next;
-    }
+  Uint8 header[RECORDING_HEADER_SIZE] = {
+      RECORDING_MAGIC[0], RECORDING_MAGIC[1], RECORDING_MAGIC[2],
+      RECORDING_MAGIC[3], RECORDING_VERSION, (Uint8)currentDifficulty,
+      tickRate & 0xff, (tickRate >> 8) & 0xff, 0, 0, 0, 0,
+      (Uint8)ballSubsteps, (Uint8)varyAutoAim,
+      levelFileCount & 0xff, (levelFileCount >> 8) & 0xff};
+  writeUint32(&header[8], seed);
+  writeUint32(&header[16], levelListHash());
+  fwrite(header, 1, sizeof(header), recordFile);
+  for (int i = 0; i < levelFileCount; i++) {
+    Uint8 bytes[4];
+    writeUint32(bytes, levelFileHashes[i]);
+    fwrite(bytes, 1, sizeof(bytes), recordFile);
   }
 }
 
-// Generic function to render text
-void renderText(SDL_Renderer *renderer, TTF_Font *font, const char *text, 
-                SDL_Color color, int x, int y) {
-  SDL_Surface *textSurface = TTF_RenderText_Solid(font, text, color);
-  if (!textSurface) {
-    printf("Failed to render text: %s\n", TTF_GetError());
-    return;
+// Append one tick's input to the recording
+void recordTick(TickInput input) {
+  if (recordFile == NULL) return;
+  if (recordRun > 0 && (input.buttons != recordLast.buttons ||
+                        input.mouseX != recordLast.mouseX ||
+                        recordRun == 0xffff)) {
+    writeInputRun(recordFile, recordLast, recordRun);
+    recordRun = 0;
   }
-  
-  SDL_Texture *textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-  if (!textTexture) {
-    printf("Failed to create texture: %s\n", SDL_GetError());
-    SDL_FreeSurface(textSurface);
-    return;
+  recordLast = input;
+  recordRun++;
+}
+
+// Load a recording for replay. Sets the seed, difficulty and tick rate it
+// was made with.
+bool loadReplay(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    printf("Could not open replay %s\n", path);
+    return false;
   }
 
-  SDL_Rect textRect = {x, y, textSurface->w, textSurface->h};
-  SDL_RenderCopy(renderer, textTexture, NULL, &textRect);
+  fseek(file, 0, SEEK_END);
+  replaySize = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  replayData = (Uint8 *)malloc(replaySize > 0 ? replaySize : 1);
+  if (replayData == NULL ||
+      fread(replayData, 1, replaySize, file) != (size_t)replaySize) {
+    printf("Could not read replay %s\n", path);
+    fclose(file);
+    free(replayData);
+    replayData = NULL;
+    return false;
+  }
+  fclose(file);
 
-  SDL_FreeSurface(textSurface);
-  SDL_DestroyTexture(textTexture);
-}
+  if (replaySize < RECORDING_HEADER_SIZE ||
+      memcmp(replayData, RECORDING_MAGIC, 4) != 0 ||
+      replayData[4] != RECORDING_VERSION) {
+    printf("%s is not a Breakout recording\n", path);
+    free(replayData);
+    replayData = NULL;
+    return false;
+  }
 
-void renderWinMessage(SDL_Renderer *renderer, TTF_Font *font, char *condition) {
-  SDL_Color green = {0, 255, 0, 255};
-  renderText(renderer, font, condition, green, 
-             SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 - 15);
+  int rate = replayData[6] | (replayData[7] << 8);
+  int files = replayData[14] | (replayData[15] << 8);
+  if (replayData[5] > DIFFICULTY_HARD || rate < 1 || rate > MAX_TICK_RATE ||
+      replaySize < RECORDING_HEADER_SIZE + 4 * files) {
+    printf("%s is not a Breakout recording\n", path);
+    free(replayData);
+    replayData = NULL;
+    return false;
+  }
+
+  // The levels decide the game as much as the input does, so a recording
+  // only plays against the level sequence it was made with
+  if (files != levelFileCount || readUint32(&replayData[16]) != levelListHash()) {
+    int level = 0;
+    while (level < files && level < levelFileCount &&
+           readUint32(&replayData[RECORDING_HEADER_SIZE + 4 * level]) ==
+               levelFileHashes[level]) {
+      level++;
+    }
+    if (files == 0) {
+      printf("%s was recorded with generated levels, run it without --levels\n", path);
+    } else if (files != levelFileCount) {
+      printf("%s was recorded with a list of %d level files, run it with the "
+             "same --levels\n", path, files);
+    } else if (level < files) {
+      printf("%s: level %d (%s) differs from the one it was recorded with\n",
+             path, level + 1, levelFiles[level]);
+    } else {
+      printf("%s is not a Breakout recording\n", path);
+    }
+    free(replayData);
+    replayData = NULL;
+    return false;
+  }
+
+  currentDifficulty = (DifficultyLevel)replayData[5];
+  tickRate = rate;
+  gameSeed = readUint32(&replayData[8]);
+  ballSubsteps = replayData[12] > 0 ? replayData[12] : 1;
+  varyAutoAim = replayData[13] != 0;
+  replayPos = RECORDING_HEADER_SIZE + 4 * files;
+  replayRunLeft = 0;
+  replaying = true;
+  return true;
 }
 
-void renderScore(SDL_Renderer *renderer, TTF_Font *font, int score) {
-  char scoreText[32];
-  sprintf(scoreText, "Score: %d", score);
-  SDL_Color white = {255, 255, 255, 255};
-  renderText(renderer, font, scoreText, white, 10, SCREEN_HEIGHT - 25);
+// Get the next tick's input from the replay. Returns false at the end.
+bool nextReplayInput(TickInput *input) {
+  if (replayRunLeft == 0) {
+    if (replayPos + 5 > replaySize) {
+      return false;
+    }
+    Uint8 *run = &replayData[replayPos];
+    replayRunLeft = run[0] | (run[1] << 8);
+    replayInput.buttons = run[2];
+    replayInput.mouseX = (Sint16)(run[3] | (run[4] << 8));
+    replayPos += 5;
+    if (replayRunLeft == 0) {
+      return false;
+    }
+  }
+  replayRunLeft--;
+  *input = replayInput;
+  return true;
 }
 
-// Render high score
-void renderHighScore(SDL_Renderer *renderer, TTF_Font *font, int highScore) {
-  if (highScore <= 0) return;
-  
-  char highScoreText[32];
-  sprintf(highScoreText, "High Score: %d", highScore);
-  SDL_Color gold = {255, 215, 0, 255}; // Gold color
-  renderText(renderer, font, highScoreText, gold, SCREEN_WIDTH - 150, SCREEN_HEIGHT - 25);
+// A fresh seed for a game that isn't being replayed
+Uint32 newGameSeed() {
+  return (Uint32)time(NULL) ^ (Uint32)SDL_GetPerformanceCounter();
 }
 
-// Render difficulty selection screen
-void renderDifficultyScreen(SDL_Renderer *renderer, TTF_Font *font) {
-  // Set background color (dark blue)
-  SDL_SetRenderDrawColor(renderer, 0, 0, 100, 255);
-  SDL_RenderClear(renderer);
-  
-  // Title
-  SDL_Color titleColor = {255, 255, 0, 255}; // Yellow
-  renderText(renderer, font, "SELECT DIFFICULTY", titleColor, SCREEN_WIDTH/2 - 120, 80);
-  
-  // Difficulty options
-  SDL_Color selected = {255, 255, 255, 255}; // White
-  SDL_Color unselected = {150, 150, 150, 255}; // Gray
-  
-  // Easy option
-  renderText(renderer, font, "Easy", 
-             (selectedDifficulty == DIFFICULTY_EASY) ? selected : unselected,
-             SCREEN_WIDTH/2 - 30, 160);
-  
-  // Medium option
-  renderText(renderer, font, "Medium", 
-             (selectedDifficulty == DIFFICULTY_MEDIUM) ? selected : unselected,
-             SCREEN_WIDTH/2 - 50, 200);
-  
-  // Hard option
-  renderText(renderer, font, "Hard", 
-             (selectedDifficulty == DIFFICULTY_HARD) ? selected : unselected,
-             SCREEN_WIDTH/2 - 30, 240);
-  
-  // Instructions
-  SDL_Color instructionColor = {200, 200, 200, 255}; // Light gray
-  renderText(renderer, font, "Up/Down: Select, Enter: Confirm, ESC: Back", 
-             instructionColor, SCREEN_WIDTH/2 - 200, SCREEN_HEIGHT - 60);
+// Start a new game from a seed. Everything random in the game comes from
+// the seed, so the seed plus the tick inputs reproduce the game exactly.
+void startNewGame(Uint32 seed) {
+  gameSeed = seed;
+  seedGameRandom(seed);
+  resetGame();
+  loadLevelBlocks(1);
+  automatic_paddle = false;
+  useMouse = false;
+  autoPaddleOffset = 0;
+  particles.count = 0;
+  pendingInput.buttons &= INPUT_HELD_MASK;
+
+  if (recordPath != NULL && !replaying) {
+    startRecording(seed);
+  }
 }
 
-// Render the lobby screen with updated options
-void renderLobby(SDL_Renderer *renderer, TTF_Font *font) {
-  // Set background color (dark blue)
-  SDL_SetRenderDrawColor(renderer, 0, 0, 80, 255);
-  SDL_RenderClear(renderer);
-  
-  // Title
-  SDL_Color titleColor = {255, 255, 0, 255}; // Yellow
-  renderText(renderer, font, "BREAKOUT", titleColor, SCREEN_WIDTH/2 - 70, 80);
-  
-  // Menu options
-  SDL_Color selected = {255, 255, 255, 255}; // White
-  SDL_Color unselected = {150, 150, 150, 255}; // Gray
-  
-  // Start Game option
-  renderText(renderer, font, "Start Game", 
-             (selectedOption == MENU_START) ? selected : unselected,
-             SCREEN_WIDTH/2 - 70, 160);
-  
-  // Difficulty option
-  renderText(renderer, font, "Difficulty", 
-             (selectedOption == MENU_DIFFICULTY) ? selected : unselected,
-             SCREEN_WIDTH/2 - 60, 200);
-  
-  // Quit option
-  renderText(renderer, font, "Quit", 
-             (selectedOption == MENU_EXIT) ? selected : unselected,
-             SCREEN_WIDTH/2 - 30, 240);
-  
-  // Current difficulty display
-  char diffText[20];
-  switch(currentDifficulty) {
-    case DIFFICULTY_EASY:
-      sprintf(diffText, "Difficulty: Easy");
-      break;
-    case DIFFICULTY_MEDIUM:
-      sprintf(diffText, "Difficulty: Medium");
-      break;
-    case DIFFICULTY_HARD:
-      sprintf(diffText, "Difficulty: Hard");
-      break;
-    case DIFFICULTY_TOTAL:
-      // This should never happen, but needed for exhaustive switch
-      sprintf(diffText, "Difficulty: Unknown");
-      break;
+// The ball the auto paddle follows: the one closest to the paddle
+int lowestBall() {
+  int lowest = 0;
+  for (int i = 1; i < balls.count; i++) {
+    if (balls.y[i] > balls.y[lowest]) {
+      lowest = i;
+    }
   }
-  renderText(renderer, font, diffText, unselected, SCREEN_WIDTH/2 - 80, 280);
-  
-  // Instructions
-  SDL_Color instructionColor = {200, 200, 200, 255}; // Light gray
-  renderText(renderer, font, "Up/Down: Select, Enter: Confirm", 
-             instructionColor, SCREEN_WIDTH/2 - 150, SCREEN_HEIGHT - 60);
-  
-  // Display high score if exists
-  renderHighScore(renderer, font, highScore);
+  return lowest;
 }
 
-// Render pause screen overlay
-void renderPauseScreen(SDL_Renderer *renderer, TTF_Font *font) {
-  // Semi-transparent overlay
-  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
-  SDL_Rect overlay = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
-  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-  SDL_RenderFillRect(renderer, &overlay);
-  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+// Advance the playing state by one fixed simulation tick
+void updatePlaying(TickInput input) {
+  // Common game objects, as they were at the start of the tick
+  Rectangle playerBlock = {player_X, player_Y, paddleWidth, 20,
+                           {23, 231, 255, 255}};
+
+  saveTickState();
+
+  // Apply this tick's input
+  if (input.buttons & INPUT_TOGGLE_AUTO) {
+    automatic_paddle = !automatic_paddle;
+  }
+  if (input.buttons & INPUT_TOGGLE_MOUSE) {
+    useMouse = !useMouse;
+  }
+  if (input.buttons & INPUT_LAUNCH) {
+    launchBall();
+  }
+  bool left = input.buttons & INPUT_LEFT;
+  bool right = input.buttons & INPUT_RIGHT;
+  player_vx = (left && !right) ? -playerSpeed :
+              (right && !left) ? playerSpeed : 0;
+
+  // Update power-ups first
+  updatePowerUps();
+  updateFallingPowerUps(playerBlock);
+  updateParticles();
   
-  // Pause message
-  SDL_Color white = {255, 255, 255, 255};
-  renderText(renderer, font, "PAUSED", white, SCREEN_WIDTH/2 - 60, SCREEN_HEIGHT/2 - 30);
+  // Mouse control
+  if (useMouse) {
+    player_X = input.mouseX - (paddleWidth / 2);
+  }
   
-  // Instructions
-  SDL_Color instructionColor = {200, 200, 200, 255};
-  renderText(renderer, font, "Press P to Resume, ESC for Menu", 
-             instructionColor, SCREEN_WIDTH/2 - 150, SCREEN_HEIGHT/2 + 20);
-}
-
-// Render game over screen
-void renderGameOverScreen(SDL_Renderer *renderer, TTF_Font *font, bool isWin) {
-  // Set background color (dark red for loss, dark green for win)
-  if (isWin) {
-    SDL_SetRenderDrawColor(renderer, 0, 50, 0, 255); // Dark green
+  // If ball hasn't been launched, keep it on paddle
+  if (!ballLaunched) {
+    balls.x[0] = player_X + (paddleWidth / 2);
+    balls.y[0] = player_Y - 15;
   } else {
-    SDL_SetRenderDrawColor(renderer, 50, 0, 0, 255); // Dark red
+    // Move the balls (velocities are in pixels per 60 Hz frame), bouncing
+    // off the walls, paddle and blocks on the way
+    for (int s = 0; s < ballSubsteps; s++) {
+      for (int i = 0; i < balls.count; i++) {
+        sweepBall(i, playerBlock, 1.0f / ballSubsteps);
+      }
+    }
   }
-  SDL_RenderClear(renderer);
-  
-  // Game result message
-  SDL_Color messageColor = isWin ? 
-                          (SDL_Color){0, 255, 0, 255} :  // Bright green
-                          (SDL_Color){255, 0, 0, 255};   // Bright red
   
-  const char* message = isWin ? "YOU WIN!" : "GAME OVER";
-  renderText(renderer, font, message, messageColor, 
-            SCREEN_WIDTH / 2 - 70, SCREEN_HEIGHT / 2 - 40);
+  // Update player position
+  player_X += player_vx * tickScale;
   
-  // Score display
-  char scoreText[32];
-  sprintf(scoreText, "Your Score: %d", score);
-  SDL_Color white = {255, 255, 255, 255};
-  renderText(renderer, font, scoreText, white, SCREEN_WIDTH/2 - 80, SCREEN_HEIGHT/2);
+  // Auto-paddle feature
+  if (automatic_paddle && ballLaunched) {
+    // Keep the lowest ball over the paddle, off center by the current aim
+    player_X = balls.x[lowestBall()] - (paddleWidth / 2) + autoPaddleOffset;
+  }
   
-  // New high score notification
-  if (score > highScore) {
-    highScore = score;
-    SDL_Color gold = {255, 215, 0, 255}; // Gold
-    renderText(renderer, font, "NEW HIGH SCORE!", gold, 
-              SCREEN_WIDTH/2 - 110, SCREEN_HEIGHT/2 + 30);
+  // Keep player within boundaries
+  if (player_X < 0) {
+    player_X = 0;
+  }
+  if (player_X > SCREEN_WIDTH - paddleWidth) {
+    player_X = SCREEN_WIDTH - paddleWidth;
   }
   
-  // Instructions
-  SDL_Color instructionColor = {200, 200, 200, 255}; // Light gray
-  renderText(renderer, font, "Press R to restart or ESC for menu", 
-            instructionColor, SCREEN_WIDTH/2 - 160, SCREEN_HEIGHT - 60);
-}
-
-// Load and initialize sound effects
-bool initSounds() {
-    // Initialize all sound pointers to NULL
-    for (int i = 0; i < MAX_SOUNDS; i++) {
-        sounds[i] = NULL;
-    }
+  // Check for win condition
+  if (totalBall <= 0) {
+    // Play level complete sound
+    playSound(SOUND_LEVEL_COMPLETE);
     
-    // Try to initialize SDL_mixer
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
-        printf("SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError());
-        printf("Sound will be disabled.\n");
-        sound_enabled = false;
-        return false;
+    // The game is won once the last level is cleared
+    if (currentLevel < levelCount()) {
+      advanceLevel();
+    } else {
+      currentState = STATE_WIN;
     }
-    
-    // Load sound effects
-    bool all_sounds_loaded = true;
-    int sounds_loaded = 0;
-    
-    for (int i = 0; i < MAX_SOUNDS; i++) {
-        sounds[i] = Mix_LoadWAV(sound_files[i]);
-        if (sounds[i] == NULL) {
-            printf("Warning: Could not load sound file: %s\n", sound_files[i]);
-            all_sounds_loaded = false;
-        } else {
-            sounds_loaded++;
-        }
+  }
+  
+  // Drop balls that fell below the screen, a life is only lost with the last
+  for (int i = balls.count - 1; i >= 0; i--) {
+    if (balls.y[i] > SCREEN_HEIGHT && balls.count > 1) {
+      removeBall(i);
     }
+  }
+  
+  // Check for lose condition (last ball below screen)
+  if (balls.y[0] > SCREEN_HEIGHT) {
+    lives--;
     
-    // Enable sound if at least some sounds were loaded
-    sound_enabled = (sounds_loaded > 0);
-    
-    if (sounds_loaded == 0) {
-        printf("No sound files could be loaded. Sound will be disabled.\n");
-        printf("To enable sound, place WAV files in the 'sounds' directory.\n");
-        return false;
-    } else if (!all_sounds_loaded) {
-        printf("Some sound files were missing. Partial sound support enabled.\n");
-        printf("Loaded %d of %d sound files.\n", sounds_loaded, MAX_SOUNDS);
+    if (lives <= 0) {
+      // Game over sound
+      playSound(SOUND_GAME_OVER);
+      currentState = STATE_GAME_OVER;
     } else {
-        printf("All sound files loaded successfully.\n");
+      // Reset ball but continue game
+      balls.x[0] = player_X + (paddleWidth / 2);
+      balls.y[0] = player_Y - 15;
+      ballLaunched = false;
+      snapInterpolation();
     }
-    
-    return sound_enabled;
+  }
 }
 
-// Clean up sound resources
-void cleanupSounds() {
-    for (int i = 0; i < MAX_SOUNDS; i++) {
-        if (sounds[i] != NULL) {
-            Mix_FreeChunk(sounds[i]);
-            sounds[i] = NULL;
-        }
+// Time the ball update (move, paddle and wall bounces, brick hits) and the
+// sprite draw of every ball for growing numbers of balls over a normal
+// 70-brick level. Drawing goes to a software renderer. The paddle spans the
+// screen so no ball is lost, and the level is laid out again whenever it is
+// cleared.
+void benchmarkBalls() {
+  const int ballCounts[] = {1, 10, 100, 1000, 10000};
+  const int ticks = 600;
+
+  // Balls are drawn with the sprite path into an offscreen surface
+  SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(
+      0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+  SDL_Renderer *renderer =
+      target ? SDL_CreateSoftwareRenderer(target) : NULL;
+  if (renderer == NULL) {
+    printf("Could not set up the ball benchmark: %s\n", SDL_GetError());
+    SDL_FreeSurface(target);
+    return;
+  }
+
+  sound_enabled = false;
+  tickScale = 1.0f;
+  ballSpeed = normalBallSpeed;
+  player_X = 0;
+  paddleWidth = SCREEN_WIDTH;
+  Rectangle playerBlock = {0, player_Y, SCREEN_WIDTH, 20, {23, 231, 255, 255}};
+  double frequency = (double)SDL_GetPerformanceFrequency();
+
+  printf("%-8s %14s %14s %12s %16s %14s\n", "balls", "update us", "draw us",
+         "draw calls", "ns/ball/tick", "60 FPS budget");
+
+  for (int c = 0; c < 5; c++) {
+    int count = ballCounts[c];
+    if (!allocBallSystem(count)) {
+      break;
     }
-    
-    Mix_CloseAudio();
+    seedGameRandom(12345);
+    for (int i = 0; i < count; i++) {
+      addBall(gameRandom() % SCREEN_WIDTH, 250 + gameRandom() % 250,
+              (gameRandom() & 1) ? ballSpeed : -ballSpeed,
+              (gameRandom() & 1) ? ballSpeed : -ballSpeed);
+    }
+    initPowerUps();
+    createBlocks(70);
+    totalBall = 70;
+    ballLaunched = true;
+
+    double updateSeconds = 0, drawSeconds = 0;
+    drawCalls = 0;
+    for (int t = 0; t < ticks; t++) {
+      Uint64 start = SDL_GetPerformanceCounter();
+      saveTickState();
+      for (int i = 0; i < balls.count; i++) {
+        sweepBall(i, playerBlock, 1.0f);
+      }
+      if (totalBall <= 0) {
+        createBlocks(70);
+        totalBall = 70;
+      }
+      Uint64 middle = SDL_GetPerformanceCounter();
+      drawBalls(renderer, 1.0f);
+      Uint64 end = SDL_GetPerformanceCounter();
+      updateSeconds += (middle - start) / frequency;
+      drawSeconds += (end - middle) / frequency;
+    }
+
+    double usPerTick = (updateSeconds + drawSeconds) * 1e6 / ticks;
+    printf("%-8d %14.2f %14.2f %12.1f %16.2f %13.1f%%\n", count,
+           updateSeconds * 1e6 / ticks, drawSeconds * 1e6 / ticks,
+           (double)drawCalls / ticks, usPerTick * 1000.0 / count,
+           usPerTick / (1e6 / 60.0) * 100.0);
+  }
+  drawCalls = 0;
+
+  clearBlocks();
+  freeBlockStore();
+  initPowerUps();
+  freeBallSystem();
+  freeBallSprites();
+  SDL_DestroyRenderer(renderer);
+  SDL_FreeSurface(target);
 }
 
-// Apply difficulty settings
-void applyDifficultySettings() {
-    switch(currentDifficulty) {
-        case DIFFICULTY_EASY:
-            lives = 5;
-            ballSpeed = normalBallSpeed * 0.8f;
-            break;
-        case DIFFICULTY_MEDIUM:
-            lives = 3;
-            ballSpeed = normalBallSpeed;
-            break;
-        case DIFFICULTY_HARD:
-            lives = 2;
-            ballSpeed = normalBallSpeed * 1.2f;
-            break;
-        case DIFFICULTY_TOTAL:
-            // This should never happen, but needed for exhaustive switch
-            lives = 3;
-            ballSpeed = normalBallSpeed;
+// Tunneling stress test: 1000 balls at 10x normal speed bounce around a
+// level of unbreakable blocks above a paddle spanning the screen, at 60 Hz
+// and 30 Hz ticks (50 and 100 pixels per tick, more than the paddle and
+// blocks are thick). After every tick each ball is checked: it must not
+// have passed the paddle, left the walls or be inside a block.
+void benchmarkTunneling() {
+  const int tickRates[] = {60, 30};
+  const int ticks = 600;
+  const int count = 1000;
+  const float speed = normalBallSpeed * 10;
+
+  sound_enabled = false;
+  ballSpeed = speed;
+  player_X = 0;
+  paddleWidth = SCREEN_WIDTH;
+  Rectangle playerBlock = {0, player_Y, SCREEN_WIDTH, 20, {23, 231, 255, 255}};
+  if (!allocBallSystem(count) || !allocParticleSystem(MAX_PARTICLES)) {
+    return;
+  }
+
+  printf("%-6s %10s %10s %8s %8s %8s %10s\n", "rate", "px/tick", "contacts",
+         "lost", "escaped", "inside", "us/tick");
+  for (int c = 0; c < 2; c++) {
+    tickScale = 60.0f / tickRates[c];
+    createBlocks(70);
+    for (int b = 0; b < blocks.count; b++) {
+      blocks.health[b] = 1 << 30; // Unbreakable
+    }
+    balls.count = 0;
+    seedGameRandom(4242);
+    for (int i = 0; i < count; i++) {
+      addBall(BALL_RADIUS + gameRandom() % (SCREEN_WIDTH - 2 * BALL_RADIUS),
+              230 + gameRandom() % 90,
+              (gameRandom() & 1) ? speed : -speed,
+              (gameRandom() & 1) ? speed : -speed);
+    }
+    ballContacts = 0;
+    int lost = 0, escaped = 0, inside = 0;
+    double seconds = 0;
+
+    for (int t = 0; t < ticks; t++) {
+      saveTickState();
+      Uint64 start = SDL_GetPerformanceCounter();
+      for (int s = 0; s < ballSubsteps; s++) {
+        for (int i = 0; i < balls.count; i++) {
+          sweepBall(i, playerBlock, 1.0f / ballSubsteps);
+        }
+      }
+      seconds += (SDL_GetPerformanceCounter() - start) /
+                 (double)SDL_GetPerformanceFrequency();
+      particles.count = 0;
+
+      for (int i = 0; i < balls.count; i++) {
+        float x = balls.x[i], y = balls.y[i];
+        if (y > playerBlock.y) {
+          lost++;
+        }
+        if (x < BALL_RADIUS - 0.01f || x > SCREEN_WIDTH - BALL_RADIUS + 0.01f ||
+            y < BALL_RADIUS - 0.01f) {
+          escaped++;
+        }
+        for (int b = 0; b < blocks.count; b++) {
+          // Distance from the center to the nearest point of the block
+          float nearX = fmaxf(blocks.x[b], fminf(x, blocks.x[b] + blocks.w[b]));
+          float nearY = fmaxf(blocks.y[b], fminf(y, blocks.y[b] + blocks.h[b]));
+          float distX = x - nearX, distY = y - nearY;
+          if (distX * distX + distY * distY < (BALL_RADIUS - 0.01f) * (BALL_RADIUS - 0.01f)) {
+            inside++;
             break;
+          }
+        }
+      }
     }
-    
-    // Update ball velocity
-    ball_vx = ballSpeed;
-    ball_vy = ballSpeed;
+
+    printf("%-6d %10.0f %10lld %8d %8d %8d %10.1f\n", tickRates[c],
+           speed * tickScale, ballContacts, lost, escaped, inside,
+           seconds * 1e6 / ticks);
+  }
+  printf("lost, escaped and inside count ball-ticks and should all be 0\n");
+
+  clearBlocks();
+  freeBlockStore();
+  freeBallSystem();
+  freeParticleSystem();
 }
 
-// Initialize level with appropriate number of blocks and layout
-void initializeLevel(int level) {
-    // Adjust difficulty based on level
-    int blockCount = 35 + (level - 1) * 5; // More blocks in higher levels
-    blockCount = (blockCount > 70) ? 70 : blockCount; // Cap at 70 blocks
-    
-    totalBall = blockCount;
-    currentLevel = level;
-    
-    // Reset power-ups
-    initPowerUps();
-    
-    // Reset paddle
-    paddleWidth = 90;
+// Time the particle update and the queue and flush that draws them, with
+// the pool topped up every tick to hold 1k, 10k and 100k live particles.
+// Renders into an offscreen surface so no window is needed.
+void benchmarkParticles() {
+  const int liveCounts[] = {1000, 10000, 100000};
+  const int ticks = 300;
+
+  SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(
+      0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+  SDL_Renderer *renderer =
+      target ? SDL_CreateSoftwareRenderer(target) : NULL;
+  if (renderer == NULL || !allocParticleSystem(MAX_PARTICLES)) {
+    printf("Could not set up the particle benchmark: %s\n", SDL_GetError());
+    SDL_FreeSurface(target);
+    return;
+  }
+  tickScale = 1.0f;
+
+  printf("%-8s %14s %14s %12s %14s\n", "live", "update us", "draw us",
+         "draw calls", "60 FPS budget");
+  for (int c = 0; c < 3; c++) {
+    particles.count = 0;
+    double updateSeconds = 0, drawSeconds = 0;
+    double frequency = (double)SDL_GetPerformanceFrequency();
+    drawCalls = 0;
+    for (int t = 0; t < ticks; t++) {
+      while (particles.count + PARTICLES_PER_EFFECT <= liveCounts[c]) {
+        createCollisionEffect(particleRandom() % SCREEN_WIDTH,
+                              particleRandom() % SCREEN_HEIGHT,
+                              (SDL_Color){255, 200, 100, 255});
+      }
+      Uint64 start = SDL_GetPerformanceCounter();
+      updateParticles();
+      Uint64 middle = SDL_GetPerformanceCounter();
+      queueParticles();
+      flushRects(renderer);
+      Uint64 end = SDL_GetPerformanceCounter();
+      updateSeconds += (middle - start) / frequency;
+      drawSeconds += (end - middle) / frequency;
+    }
+    double usPerTick = (updateSeconds + drawSeconds) * 1e6 / ticks;
+    printf("%-8d %14.1f %14.1f %12.1f %13.1f%%\n", liveCounts[c],
+           updateSeconds * 1e6 / ticks, drawSeconds * 1e6 / ticks,
+           (double)drawCalls / ticks, usPerTick / (1e6 / 60.0) * 100.0);
+  }
+  printf("peak %d of %d, %d refused\n", particles.peak, particles.capacity,
+         particles.refused);
+  drawCalls = 0;
+
+  freeParticleSystem();
+  freeRectBatch();
+  SDL_DestroyRenderer(renderer);
+  SDL_FreeSurface(target);
 }
 
-// Reset game to initial state
-void resetGame() {
-  // Reset player
-  player_X = SCREEN_WIDTH / 2 - 20;
-  player_Y = SCREEN_HEIGHT - (20 * 3);
-  player_vx = 0;
-  player_vy = 0;
-  
-  // Reset ball
-  ball_x = SCREEN_WIDTH / 2 - 10;
-  ball_y = SCREEN_HEIGHT / 2 - 10;
-  
-  // Apply difficulty settings
-  applyDifficultySettings();
-  
-  // Reset game variables
-  score = 0;
-  ballLaunched = false;
-  paused = false;
-  
-  // Initialize ball velocity (moved from global initialization)
-  ball_vx = ballSpeed;
-  ball_vy = ballSpeed;
-  
-  // Initialize level 1
-  initializeLevel(1);
-  
-  // Initialize power-ups
+// Play games back to back with the auto paddle and no window, renderer or
+// audio. Every game is seeded from the run's seed, so the same seed always
+// gives the same results.
+void runHeadless(int games, Uint32 seed) {
+  // Give up on a game after 5 minutes per level
+  int maxTicks = 300 * tickRate * levelCount();
+  int wins = 0, losses = 0, timeouts = 0;
+  long long totalScore = 0, totalTicks = 0;
+  Uint32 checksum = 2166136261u;
+
+  sound_enabled = false;
+  varyAutoAim = true;
+  Uint64 start = SDL_GetPerformanceCounter();
+
+  for (int game = 0; game < games; game++) {
+    startNewGame(seed + game);
+
+    // The auto paddle plays: it's switched on in the first tick, after that
+    // the only key ever pressed is launch
+    TickInput input = {INPUT_TOGGLE_AUTO | INPUT_LAUNCH, 0};
+    int ticks = 0;
+    while (currentState == STATE_PLAYING && ticks < maxTicks) {
+      recordTick(input);
+      updatePlaying(input);
+      input.buttons = INPUT_LAUNCH;
+      ticks++;
+    }
+
+    if (currentState == STATE_WIN) wins++;
+    else if (currentState == STATE_GAME_OVER) losses++;
+    else timeouts++;
+    totalScore += score;
+    totalTicks += ticks;
+
+    // Fold every game's result into a checksum for comparing runs
+    Uint32 results[3] = {(Uint32)score, (Uint32)ticks, (Uint32)currentState};
+    for (int i = 0; i < 3; i++) {
+      checksum = (checksum ^ results[i]) * 16777619u;
+    }
+  }
+
+  double seconds =
+      (SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+  finishRecording(); // --record keeps the last game
+  clearBlocks();
+  freeBlockStore();
+  freeLevelList();
   initPowerUps();
-  
-  // Switch to playing state
-  currentState = STATE_PLAYING;
+
+  printf("games: %d  seed: %u  tick rate: %d Hz\n", games, seed, tickRate);
+  printf("wins: %d  losses: %d  timeouts: %d\n", wins, losses, timeouts);
+  printf("average score: %.1f  average ticks: %.0f\n",
+         games > 0 ? (double)totalScore / games : 0.0,
+         games > 0 ? (double)totalTicks / games : 0.0);
+  printf("checksum: %08x\n", checksum);
+  printf("power-up pool: peak %d of %d, %d refused\n", powerUpsPeak,
+         MAX_POWER_UPS, powerUpsRefused);
+  printf("particles: peak %d of %d, %d refused\n", particles.peak,
+         particles.capacity, particles.refused);
+  printf("%.3f s  %.1f games/s  %.0f ticks/s\n", seconds,
+         seconds > 0 ? games / seconds : 0.0,
+         seconds > 0 ? totalTicks / seconds : 0.0);
 }
 
-// Create visual effects for collisions
-void createCollisionEffect(int x, int y, SDL_Color color) {
-    // Placeholder for particle effects
-    // This would normally create particles, but for simplicity we'll leave it empty
+// Play a loaded replay to the end as fast as possible, with no window
+void runReplay() {
+  sound_enabled = false;
+  Uint64 start = SDL_GetPerformanceCounter();
+
+  startNewGame(gameSeed);
+  TickInput input;
+  while (currentState == STATE_PLAYING && nextReplayInput(&input)) {
+    updatePlaying(input);
+    replayTicks++;
+  }
+
+  double seconds =
+      (SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+  const char *result = currentState == STATE_WIN         ? "win"
+                       : currentState == STATE_GAME_OVER ? "game over"
+                                                         : "unfinished";
+  printf("seed: %u  tick rate: %d Hz\n", gameSeed, tickRate);
+  printf("score: %d  lives: %d  ticks: %d  result: %s\n", score, lives,
+         replayTicks, result);
+  printf("%.3f s  %.0f ticks/s\n", seconds,
+         seconds > 0 ? replayTicks / seconds : 0.0);
+
+  clearBlocks();
+  freeBlockStore();
+  initPowerUps();
 }
 
-int main() {
-  // Seed random number generator
+int main(int argc, char *argv[]) {
+  launchCounter = SDL_GetPerformanceCounter();
+
+  // Seed random number generators, headless runs reseed from --seed
   srand(time(NULL));
+  seedGameRandom((Uint32)time(NULL));
+
+  // Collision benchmark runs without opening a window
+  if (argc > 1 && strcmp(argv[1], "--bench-collision") == 0) {
+    benchmarkCollision();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-blocks") == 0) {
+    benchmarkBlockStore();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-ball") == 0) {
+    benchmarkBallDrawing();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-rects") == 0) {
+    benchmarkRectDrawing();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-multiball") == 0) {
+    benchmarkBalls();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-tunneling") == 0) {
+    benchmarkTunneling();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-particles") == 0) {
+    benchmarkParticles();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-audio") == 0) {
+    benchmarkAudio();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-levels") == 0) {
+    benchmarkLevels();
+    return 0;
+  }
+  if (argc > 3 && strcmp(argv[1], "--convert-level") == 0) {
+    return convertLevelFile(argv[2], argv[3]) ? 0 : -1;
+  }
+  bool headless = false;
+  bool noRender = false;
+  const char *replayPath = NULL;
+  int headlessGames = 100;
+  Uint32 headlessSeed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--text-stats") == 0) {
+      showTextStats = true;
+    } else if (strcmp(argv[i], "--draw-stats") == 0) {
+      showDrawStats = true;
+    } else if (strcmp(argv[i], "--pool-stats") == 0) {
+      showPoolStats = true;
+    } else if (strcmp(argv[i], "--startup-stats") == 0) {
+      showStartupStats = true;
+    } else if (strcmp(argv[i], "--audio-stats") == 0) {
+      showAudioStats = true;
+    } else if (strcmp(argv[i], "--audio-buffer") == 0 && i + 1 < argc) {
+      // A power of two from 256 to 4096 sample frames
+      int frames = atoi(argv[++i]);
+      audioBufferSize = 256;
+      while (audioBufferSize < frames && audioBufferSize < 4096) {
+        audioBufferSize *= 2;
+      }
+    } else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+      tickRate = atoi(argv[++i]);
+      if (tickRate < 1) tickRate = 60;
+      if (tickRate > MAX_TICK_RATE) tickRate = MAX_TICK_RATE;
+    } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+      targetFps = atoi(argv[++i]);
+      if (targetFps < 0) targetFps = 0;
+    } else if (strcmp(argv[i], "--headless") == 0) {
+      headless = true;
+    } else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+      headlessGames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      headlessSeed = (Uint32)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "easy") == 0) currentDifficulty = DIFFICULTY_EASY;
+      else if (strcmp(argv[i], "hard") == 0) currentDifficulty = DIFFICULTY_HARD;
+      else currentDifficulty = DIFFICULTY_MEDIUM;
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      recordPath = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replayPath = argv[++i];
+    } else if (strcmp(argv[i], "--replay-speed") == 0 && i + 1 < argc) {
+      replaySpeed = atof(argv[++i]);
+      if (replaySpeed <= 0) replaySpeed = 1.0;
+    } else if (strcmp(argv[i], "--substeps") == 0 && i + 1 < argc) {
+      ballSubsteps = atoi(argv[++i]);
+      if (ballSubsteps < 1) ballSubsteps = 1;
+      if (ballSubsteps > 255) ballSubsteps = 255;
+    } else if (strcmp(argv[i], "--no-render") == 0) {
+      noRender = true;
+    } else if (strcmp(argv[i], "--levels") == 0 && i + 1 < argc) {
+      if (!loadLevelList(argv[++i])) {
+        freeLevelList();
+        return -1;
+      }
+    }
+  }
+
+  // The recording decides the seed, difficulty and tick rate
+  if (replayPath != NULL && !loadReplay(replayPath)) {
+    return -1;
+  }
+  tickScale = 60.0f / tickRate;
+
+  if (!allocBallSystem(MAX_BALLS) || !allocParticleSystem(MAX_PARTICLES)) {
+    return -1;
+  }
+
+  if (replaying && noRender) {
+    runReplay();
+    return 0;
+  }
+
+  // Simulation only, no SDL subsystems are initialized
+  if (headless) {
+    runHeadless(headlessGames, headlessSeed);
+    return 0;
+  }
+
+  // Has to happen before SDL allocates anything
+  if (showTextStats) {
+    countSdlAllocations();
+  }
 
-  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
+  int phase = beginStartupPhase("init video", "main");
+  if (SDL_Init(SDL_INIT_VIDEO) < 0) {
     SDL_Log("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
     return -1;
   }
+  endStartupPhase(phase);
+
+  // Only the audio subsystem is started here, the asset loader opens the
+  // mixer and loads the sounds
+  phase = beginStartupPhase("init audio", "main");
+  audioInitialized = SDL_InitSubSystem(SDL_INIT_AUDIO) == 0;
+  endStartupPhase(phase);
+  if (!audioInitialized) {
+    SDL_Log("SDL audio could not initialize! SDL_Error: %s\n", SDL_GetError());
+  }
 
+  phase = beginStartupPhase("init ttf", "main");
   if (TTF_Init() == -1) {
     printf("TTF_Init: %s\n", TTF_GetError());
     return -1;
   }
-  
-  // Initialize SDL_mixer and load sounds
-  if (!initSounds()) {
-    printf("Warning: Sound initialization failed. Continuing without sound.\n");
-  }
+  endStartupPhase(phase);
 
-  // Load a font (you must have this TTF file)
-  TTF_Font *font = TTF_OpenFont("arial.ttf", 24);
-  if (!font) {
-    printf("Failed to load font: %s\n", TTF_GetError());
-    SDL_Quit();
+  // Load the font and sounds in the background while the window comes up
+  if (!startAssetLoader()) {
+    SDL_Log("Asset loader could not be started! SDL_Error: %s\n", SDL_GetError());
     return -1;
   }
 
+  phase = beginStartupPhase("create window", "main");
   SDL_Window *window = SDL_CreateWindow(
       "2D Game Engine", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
       SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+  endStartupPhase(phase);
 
   if (window == NULL) {
     SDL_Log("Window could not be created! SDL_Error: %s\n", SDL_GetError());
     return -1;
   }
 
+  phase = beginStartupPhase("create renderer", "main");
   SDL_Renderer *renderer =
       SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+  endStartupPhase(phase);
   if (renderer == NULL) {
     SDL_Log("Renderer could not be created! SDL_Error: %s\n", SDL_GetError());
     SDL_DestroyWindow(window);
@@ -1014,20 +4249,72 @@ int main() {
     return -1;
   }
 
+  // The first frame needs the font (you must have this TTF file)
+  phase = beginStartupPhase("wait for font", "main");
+  TTF_Font *font = waitForFont();
+  endStartupPhase(phase);
+  if (!font) {
+    printf("Failed to load font: %s\n", TTF_GetError());
+    pollAssetLoader(true);
+    cleanupSounds();
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return -1;
+  }
+
+  // A windowed replay skips the lobby
+  if (replaying) {
+    startNewGame(gameSeed);
+  }
+
   // Game loop
   bool isRunning = true;
   SDL_Event event;
 
-  // Block list starts as NULL until game begins
-  BlockNode *blockList = NULL;
+  // HUD lines that are only laid out again when their value changes
+  HudText livesHud = {.format = "Lives: %d"};
+  HudText levelHud = {.format = "Level: %d"};
+  HudText drawCallsHud = {.format = "Draw calls: %d"};
+  HudText particlesHud = {.format = "Particles: %d"};
+  int frameDrawCalls = 0;
+
+  // Text allocation tracking for --text-stats
+  Uint32 statsTime = SDL_GetTicks();
+  int statsFrames = 0;
+  int statsAllocations = textAllocations;
+  int statsHeapAllocations = SDL_AtomicGet(&sdlHeapAllocations);
+  int statsDrawCalls = 0;
+
+  // Fixed-step timing: real time is banked in the accumulator and spent in
+  // whole simulation ticks
+  double perfFrequency = (double)SDL_GetPerformanceFrequency();
+  double tickSeconds = 1.0 / tickRate;
+  double frameSeconds = targetFps > 0 ? 1.0 / targetFps : 0.0;
+  double accumulator = 0.0;
+  Uint64 lastCounter = SDL_GetPerformanceCounter();
 
   // Start in lobby state
   currentState = STATE_LOBBY;
 
+  // Startup milestones for --startup-stats
+  int firstFramePhase = beginStartupPhase("first frame", "main");
+  double firstFrameMs = 0;
+  bool startupReported = false;
+
   while (isRunning) {
-    // Common game objects
-    Rectangle playerBlock = {player_X, player_Y, 90, 20, {23, 231, 255, 255}};
-    struct Arc ball = {ball_x, ball_y, 10, 0, M_PI * 2, {255, 0, 0, 255}};
+    Uint64 frameStart = SDL_GetPerformanceCounter();
+
+    // Sound comes on once the loader has finished with it
+    pollAssetLoader(false);
+    beginSoundFrame();
+
+    double elapsed = (frameStart - lastCounter) / perfFrequency;
+    lastCounter = frameStart;
+    // Don't try to catch up after a long stall (window drag, breakpoint)
+    if (elapsed > 0.25) {
+      elapsed = 0.25;
+    }
 
     // Event handling - common for all states
     while (SDL_PollEvent(&event)) {
@@ -1041,15 +4328,10 @@ int main() {
         if (event.key.keysym.sym == SDLK_ESCAPE) {
           // ESC key returns to lobby from any state except lobby itself
           if (currentState != STATE_LOBBY) {
-            // Free block list when returning to lobby
-            BlockNode *current = blockList;
-            while (current != NULL) {
-              BlockNode *next = current->next;
-              free(current);
-              current = next;
-            }
-            blockList = NULL;
+            // Drop the level's blocks when returning to lobby
+            clearBlocks();
             currentState = STATE_LOBBY;
+            replaying = false;
           }
         }
 
@@ -1058,32 +4340,27 @@ int main() {
           case STATE_LOBBY:
             // Lobby navigation
             if (event.key.keysym.sym == SDLK_UP) {
-              // Play menu selection sound if sound is enabled
-              if (sound_enabled && sounds[SOUND_MENU_SELECT] != NULL) {
-                  Mix_PlayChannel(-1, sounds[SOUND_MENU_SELECT], 0);
-              }
+              // Play menu selection sound
+              playSound(SOUND_MENU_SELECT);
               
               // Move selection up
               selectedOption = (selectedOption == MENU_START) ? MENU_EXIT : 
                               (selectedOption == MENU_EXIT) ? MENU_DIFFICULTY : MENU_START;
             } else if (event.key.keysym.sym == SDLK_DOWN) {
               // Play menu selection sound
-              Mix_PlayChannel(-1, sounds[SOUND_MENU_SELECT], 0);
+              playSound(SOUND_MENU_SELECT);
               
               // Move selection down
               selectedOption = (selectedOption == MENU_START) ? MENU_DIFFICULTY : 
                               (selectedOption == MENU_DIFFICULTY) ? MENU_EXIT : MENU_START;
             } else if (event.key.keysym.sym == SDLK_RETURN || 
                       event.key.keysym.sym == SDLK_SPACE) {
-              // Play menu click sound if sound is enabled
-              if (sound_enabled && sounds[SOUND_MENU_CLICK] != NULL) {
-                  Mix_PlayChannel(-1, sounds[SOUND_MENU_CLICK], 0);
-              }
+              // Play menu click sound
+              playSound(SOUND_MENU_CLICK);
               
               if (selectedOption == MENU_START) {
                 // Start new game
-                resetGame();
-                blockList = createBlockList(totalBall);
+                startNewGame(newGameSeed());
               } else if (selectedOption == MENU_DIFFICULTY) {
                 // Go to difficulty selection screen
                 currentState = STATE_DIFFICULTY;
@@ -1098,14 +4375,14 @@ int main() {
             // Difficulty selection navigation
             if (event.key.keysym.sym == SDLK_UP) {
               // Play menu selection sound
-              Mix_PlayChannel(-1, sounds[SOUND_MENU_SELECT], 0);
+              playSound(SOUND_MENU_SELECT);
               
               // Move selection up
               selectedDifficulty = (selectedDifficulty == DIFFICULTY_EASY) ? DIFFICULTY_HARD : 
                                   (selectedDifficulty == DIFFICULTY_MEDIUM) ? DIFFICULTY_EASY : DIFFICULTY_MEDIUM;
             } else if (event.key.keysym.sym == SDLK_DOWN) {
               // Play menu selection sound
-              Mix_PlayChannel(-1, sounds[SOUND_MENU_SELECT], 0);
+              playSound(SOUND_MENU_SELECT);
               
               // Move selection down
               selectedDifficulty = (selectedDifficulty == DIFFICULTY_EASY) ? DIFFICULTY_MEDIUM : 
@@ -1113,7 +4390,7 @@ int main() {
             } else if (event.key.keysym.sym == SDLK_RETURN || 
                       event.key.keysym.sym == SDLK_SPACE) {
               // Play menu click sound
-              Mix_PlayChannel(-1, sounds[SOUND_MENU_CLICK], 0);
+              playSound(SOUND_MENU_CLICK);
               
               // Set difficulty and return to main menu
               currentDifficulty = selectedDifficulty;
@@ -1125,25 +4402,19 @@ int main() {
             break;
 
           case STATE_PLAYING:
-            // Game controls
+            // Game controls, applied on the next simulation tick
             if (event.key.keysym.sym == SDLK_a) {
-              player_vx = -playerSpeed;
+              pendingInput.buttons |= INPUT_LEFT;
             } else if (event.key.keysym.sym == SDLK_d) {
-              player_vx = playerSpeed;
+              pendingInput.buttons |= INPUT_RIGHT;
             } else if (event.key.keysym.sym == SDLK_f && !event.key.repeat) {
-              automatic_paddle = !automatic_paddle;
+              pendingInput.buttons |= INPUT_TOGGLE_AUTO;
             } else if (event.key.keysym.sym == SDLK_m && !event.key.repeat) {
               // Toggle mouse control
-              useMouse = !useMouse;
+              pendingInput.buttons |= INPUT_TOGGLE_MOUSE;
             } else if (event.key.keysym.sym == SDLK_SPACE) {
               // Launch the ball if not launched yet
-              if (!ballLaunched) {
-                ballLaunched = true;
-                
-                // Set initial ball velocity
-                ball_vx = ballSpeed;
-                ball_vy = -ballSpeed; // Start going up
-              }
+              pendingInput.buttons |= INPUT_LAUNCH;
             } else if (event.key.keysym.sym == SDLK_p) {
               // Toggle pause
               paused = !paused;
@@ -1153,20 +4424,9 @@ int main() {
           case STATE_GAME_OVER:
           case STATE_WIN:
             // Game over/win controls
-            if (event.key.keysym.sym == SDLK_r) {
-              // Restart game
-              resetGame();
-              
-              // Free old block list
-              BlockNode *current = blockList;
-              while (current != NULL) {
-                BlockNode *next = current->next;
-                free(current);
-                current = next;
-              }
-              
-              // Create new block list
-              blockList = createBlockList(totalBall);
+            if (event.key.keysym.sym == SDLK_r && !replaying) {
+              // Restart game, the blocks reuse the level's allocation
+              startNewGame(newGameSeed());
             }
             break;
 
@@ -1174,15 +4434,20 @@ int main() {
             break;
         }
       } else if (event.type == SDL_KEYUP) {
-        // Handle key releases for gameplay
-        if (currentState == STATE_PLAYING) {
-          if (event.key.keysym.sym == SDLK_a || event.key.keysym.sym == SDLK_d) {
-            player_vx = 0;
-          }
+        // Handle key releases for gameplay, in any state so no key sticks
+        if (event.key.keysym.sym == SDLK_a) {
+          pendingInput.buttons &= ~INPUT_LEFT;
+        } else if (event.key.keysym.sym == SDLK_d) {
+          pendingInput.buttons &= ~INPUT_RIGHT;
         }
       }
     }
 
+    // The mouse is sampled once a frame and used by every tick in it
+    int mouseX;
+    SDL_GetMouseState(&mouseX, NULL);
+    pendingInput.mouseX = (Sint16)mouseX;
+
     // State-specific updates and rendering
     switch (currentState) {
       case STATE_LOBBY:
@@ -1191,144 +4456,79 @@ int main() {
         break;
 
       case STATE_PLAYING:
+        // Run as many fixed ticks as the elapsed time pays for
         if (!paused) {
-          // Update power-ups first
-          updatePowerUps();
-          updateFallingPowerUps(playerBlock);
-          
-          // Mouse control
-          if (useMouse) {
-            int mouseX;
-            SDL_GetMouseState(&mouseX, NULL);
-            player_X = mouseX - (paddleWidth / 2);
-          }
-          
-          // If ball hasn't been launched, keep it on paddle
-          if (!ballLaunched) {
-            ball_x = player_X + (paddleWidth / 2);
-            ball_y = player_Y - 15;
-          } else {
-            // Update ball position
-            ball_x += ball_vx;
-            ball_y += ball_vy;
-          }
-          
-          // Ball-paddle collision
-          if (checkCollision(ball, playerBlock) && ball_vy > 0) { // Only collide when ball moving down
-            // Play paddle hit sound if sound is enabled
-            if (sound_enabled && sounds[SOUND_PADDLE_HIT] != NULL) {
-                Mix_PlayChannel(-1, sounds[SOUND_PADDLE_HIT], 0);
-            }
-            
-            // Bounce ball
-            ball_vy = -ballSpeed;
-            
-            // Angle based on where the ball hits the paddle
-            float hitPosition = (ball.x - player_X) / paddleWidth;
-            ball_vx = ballSpeed * (hitPosition - 0.5f) * 2; // -ballSpeed to +ballSpeed
-            
-            // Create visual effect
-            createCollisionEffect(ball.x, ball.y, (SDL_Color){100, 100, 255, 255});
-          }
-          
-          // Ball-wall collisions
-          if (ball_x < 0 + ball.r) {
-            ball_vx = fabs(ball_vx); // Ensure positive (moving right)
-            createCollisionEffect(ball.x, ball.y, (SDL_Color){255, 100, 100, 255});
-          }
-          if (ball_x > SCREEN_WIDTH - ball.r) {
-            ball_vx = -fabs(ball_vx); // Ensure negative (moving left)
-            createCollisionEffect(ball.x, ball.y, (SDL_Color){255, 100, 100, 255});
-          }
-          if (ball_y < 0 + ball.r) {
-            ball_vy = fabs(ball_vy); // Ensure positive (moving down)
-            createCollisionEffect(ball.x, ball.y, (SDL_Color){255, 100, 100, 255});
-          }
-          
-          // Update player position
-          player_X += player_vx;
-          
-          // Auto-paddle feature
-          if (automatic_paddle && ballLaunched) {
-            player_X = ball_x - (paddleWidth / 2); // Center paddle under ball
-          }
-          
-          // Keep player within boundaries
-          if (player_X < 0) {
-            player_X = 0;
-          }
-          if (player_X > SCREEN_WIDTH - paddleWidth) {
-            player_X = SCREEN_WIDTH - paddleWidth;
-          }
-          
-          // Check for ball-block collisions
-          if (ballLaunched) {
-            breakBlock(ball, &blockList);
-          }
-          
-          // Check for win condition
-          if (totalBall <= 0) {
-            // Play level complete sound if sound is enabled
-            if (sound_enabled && sounds[SOUND_LEVEL_COMPLETE] != NULL) {
-                Mix_PlayChannel(-1, sounds[SOUND_LEVEL_COMPLETE], 0);
-            }
-            
-            // For now, just go to win screen
-            currentState = STATE_WIN;
-            
-            // TODO: Implement level progression
-            // currentLevel++;
-            // initializeLevel(currentLevel);
-            // blockList = createBlockList(totalBall);
-            // ballLaunched = false;
-          }
-          
-          // Check for lose condition (ball below screen)
-          if (ball_y > SCREEN_HEIGHT) {
-            lives--;
-            
-            if (lives <= 0) {
-              // Game over sound if sound is enabled
-              if (sound_enabled && sounds[SOUND_GAME_OVER] != NULL) {
-                  Mix_PlayChannel(-1, sounds[SOUND_GAME_OVER], 0);
-              }
-              currentState = STATE_GAME_OVER;
-            } else {
-              // Reset ball but continue game
-              ball_x = player_X + (paddleWidth / 2);
-              ball_y = player_Y - 15;
-              ballLaunched = false;
+          accumulator += replaying ? elapsed * replaySpeed : elapsed;
+          while (accumulator >= tickSeconds && currentState == STATE_PLAYING) {
+            TickInput input = pendingInput;
+            if (replaying && !nextReplayInput(&input)) {
+              // Recording ran out mid-game, pause and hand over the controls
+              printf("Replay finished after %d ticks, score %d\n",
+                     replayTicks, score);
+              replaying = false;
+              paused = true;
+              break;
             }
+
+            recordTick(input);
+            updatePlaying(input);
+            if (replaying) replayTicks++;
+            accumulator -= tickSeconds;
+
+            // Presses only count for the one tick that consumed them
+            pendingInput.buttons &= INPUT_HELD_MASK;
           }
+        } else {
+          accumulator = 0.0;
         }
-        
+
+        // A replay that played out to the end of the game
+        if (replaying && currentState != STATE_PLAYING) {
+          printf("Replay finished after %d ticks, score %d\n", replayTicks,
+                 score);
+        }
+
         // Render game elements
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
         SDL_RenderClear(renderer);
         
-        // Update player block with correct width
-        playerBlock.w = paddleWidth;
+        // Blend between the last two ticks by how far into the next one we are
+        float alpha = (float)(accumulator / tickSeconds);
+        Rectangle playerBlock = {
+            prevPlayer_X + (player_X - prevPlayer_X) * alpha, player_Y,
+            paddleWidth, 20, {23, 231, 255, 255}};
         
-        // Draw game elements
-        drawRectangle(renderer, playerBlock);
-        drawArc(renderer, ball);
-        drawBlocks(renderer, blockList);
-        renderFallingPowerUps(renderer);
+        // Draw game elements, every rectangle goes out in one batch
+        queueRect(playerBlock);
+        queueBlocks();
+        queueFallingPowerUps();
+        queueParticles();
+        flushRects(renderer);
+        drawBalls(renderer, alpha);
         
         // Display HUD
         renderScore(renderer, font, score);
         renderHighScore(renderer, font, highScore);
         
         // Display lives
-        char livesText[20];
-        sprintf(livesText, "Lives: %d", lives);
         SDL_Color livesColor = {255, 255, 255, 255};
-        renderText(renderer, font, livesText, livesColor, 10, 10);
+        renderHudText(renderer, font, &livesHud, lives, livesColor, 10, 10);
         
         // Display level
-        char levelText[20];
-        sprintf(levelText, "Level: %d", currentLevel);
-        renderText(renderer, font, levelText, livesColor, SCREEN_WIDTH - 100, 10);
+        renderHudText(renderer, font, &levelHud, currentLevel, livesColor,
+                      SCREEN_WIDTH - 100, 10);
+
+        // Draw calls of the previous frame
+        if (showDrawStats) {
+          renderHudText(renderer, font, &drawCallsHud, frameDrawCalls,
+                        livesColor, 10, 100);
+        }
+
+        // Live particles, the peak is printed on exit
+        if (showPoolStats) {
+          renderHudText(renderer, font, &particlesHud, particles.count,
+                        livesColor, 10, 130);
+        }
         
         // Display launch instruction if ball not launched
         if (!ballLaunched) {
@@ -1373,37 +4573,84 @@ int main() {
 
     // Present rendered frame
     SDL_RenderPresent(renderer);
+    if (firstFrameMs == 0) {
+      endStartupPhase(firstFramePhase);
+      firstFrameMs = msSinceLaunch();
+    }
+    if (showStartupStats && !startupReported && assetLoader.thread == NULL) {
+      printStartupReport(firstFrameMs, assetLoader.readyMs);
+      startupReported = true;
+    }
+    frameDrawCalls = drawCalls;
+    statsDrawCalls += drawCalls;
+    drawCalls = 0;
+
+    // Report text allocations and draw calls per frame once a second
+    statsFrames++;
+    if ((showTextStats || showDrawStats) &&
+        SDL_GetTicks() - statsTime >= 1000) {
+      if (showTextStats) {
+        int heapAllocations = SDL_AtomicGet(&sdlHeapAllocations);
+        printf("text allocations: %d in %d frames (%d total), "
+               "SDL heap allocations: %.1f per frame\n",
+               textAllocations - statsAllocations, statsFrames,
+               textAllocations,
+               (double)(heapAllocations - statsHeapAllocations) / statsFrames);
+        statsHeapAllocations = heapAllocations;
+      }
+      if (showDrawStats) {
+        printf("draw calls: %.1f per frame over %d frames\n",
+               (double)statsDrawCalls / statsFrames, statsFrames);
+      }
+      statsTime = SDL_GetTicks();
+      statsFrames = 0;
+      statsAllocations = textAllocations;
+      statsDrawCalls = 0;
+    }
     
-    // Cap frame rate
-    SDL_Delay(1000 / 60);
+    // Outside of play the accumulator shouldn't bank time
+    if (currentState != STATE_PLAYING) {
+      accumulator = 0.0;
+    }
+
+    // Sleep off whatever is left of this frame's time budget
+    if (frameSeconds > 0) {
+      double frameTime = (SDL_GetPerformanceCounter() - frameStart) / perfFrequency;
+      int remainingMs = (int)((frameSeconds - frameTime) * 1000.0);
+      if (remainingMs > 0) {
+        SDL_Delay(remainingMs);
+      }
+    }
   }
 
   // Cleanup - outside the game loop
-  // Free the block list
-  BlockNode *current = blockList;
-  while (current != NULL) {
-    BlockNode *next = current->next;
-    free(current);
-    current = next;
-  }
-  
-  // Free power-ups
-  PowerUp* powerUp = activePowerUps;
-  while (powerUp != NULL) {
-    PowerUp* next = powerUp->next;
-    free(powerUp);
-    powerUp = next;
-  }
+  finishRecording();
+  free(replayData);
+  freeBallSystem();
+  freeRectBatch();
+
+  // Free the block store
+  clearBlocks();
+  freeBlockStore();
+  freeLevelList();
   
-  powerUp = fallingPowerUps;
-  while (powerUp != NULL) {
-    PowerUp* next = powerUp->next;
-    free(powerUp);
-    powerUp = next;
+  // Power-ups live in a static pool, report how much of it was used
+  if (showPoolStats) {
+    printf("power-up pool: peak %d of %d, %d refused\n", powerUpsPeak,
+           MAX_POWER_UPS, powerUpsRefused);
+    printf("particles: peak %d of %d, %d refused\n", particles.peak,
+           particles.capacity, particles.refused);
   }
+  freeParticleSystem();
 
-  // Clean up SDL resources
+  // Clean up SDL resources, once the loader is done with the sounds
+  pollAssetLoader(true);
+  if (showStartupStats && !startupReported) {
+    printStartupReport(firstFrameMs, assetLoader.readyMs);
+  }
   cleanupSounds();
+  freeGlyphAtlas();
+  freeBallSprites();
   TTF_CloseFont(font);
   TTF_Quit();
   SDL_DestroyRenderer(renderer);
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 // Constants
@@ -11,87 +12,175 @@
 #define SCREEN_HEIGHT 400
 #define GRID_SIZE 20     // Size of each snake segment and grid cell
 #define INITIAL_LENGTH 3 // Initial snake length
-#define GAME_SPEED 10    // Frames per second
+#define GAME_SPEED 10    // Default snake moves per second
 
 // Direction enumeration
 typedef enum { UP, RIGHT, DOWN, LEFT } Direction;
 
-// Structure for snake segment (node in doubly linked list)
-typedef struct SnakeSegment {
-  int x, y;                  // Position of segment
-  SDL_Color color;           // Color of segment
-  struct SnakeSegment *prev; // Pointer to previous segment
-  struct SnakeSegment *next; // Pointer to next segment
-} SnakeSegment;
+// A grid cell, in cells rather than pixels
+typedef struct {
+  int x, y;
+} Cell;
 
 // Structure for food
 typedef struct {
-  int x, y;
+  int x, y; // Cell the food sits in
   SDL_Color color;
 } Food;
 
+// The snake body is a ring buffer of cells, head first. The buffer has one
+// entry per grid cell so the snake can never outgrow it, and moving is a
+// push at the head plus a pop at the tail with no allocation.
+typedef struct {
+  Cell *cells;
+  int capacity; // Entries in cells, one per grid cell
+  int head;     // Index of the head in cells
+  int length;   // Segments from the head back to the tail
+} SnakeBody;
+
 // Global variables
-SnakeSegment *snake_head = NULL;     // Head of the snake
-SnakeSegment *snake_tail = NULL;     // Tail of the snake
+int grid_cols = SCREEN_WIDTH / GRID_SIZE;  // Playfield size in cells, set
+int grid_rows = SCREEN_HEIGHT / GRID_SIZE; // with --world
+int camera_x = 0, camera_y = 0;            // World pixel at the window's corner
+
+// The scene only changes when the snake moves, so it is drawn into a
+// texture on ticks and every frame just copies that texture out
+SDL_Texture *scene_cache = NULL;
+bool scene_dirty = true;      // The cached scene is out of date
+int draw_calls = 0;           // Render submissions, reset every frame
+bool show_draw_stats = false; // Print draw calls per frame once a second
+
+// Most cells the window can show at once, with the camera between cells
+#define MAX_VISIBLE_COLS (SCREEN_WIDTH / GRID_SIZE + 1)
+#define MAX_VISIBLE_CELLS (MAX_VISIBLE_COLS * (SCREEN_HEIGHT / GRID_SIZE + 1))
+SnakeBody snake = {0};               // The snake
 Food food;                           // Food item
 Direction current_direction = RIGHT; // Initial direction
 Direction next_direction = RIGHT;    // Next direction (for buffering input)
 int score = 0;                       // Player's score
 bool game_over = false;              // Game over flag
 bool should_grow = false;            // Flag to indicate if snake should grow
+int tick_rate = GAME_SPEED;          // Snake moves per second
+
+// Grid occupancy, kept in step with the body by insertHead() and
+// deleteTail(). The bitmap has one bit per cell. free_cells lists every
+// cell not under the snake in no particular order, and free_slot maps a
+// cell back to its place in that list (-1 while occupied), so a free cell
+// is taken or given back in O(1).
+Uint64 *occupied = NULL;
+int *free_cells = NULL;
+int *free_slot = NULL;
+int free_count = 0;
+bool head_on_body = false; // The last head insert landed on the body
+int target_fps = 60;                 // Render frame cap, 0 for uncapped
+
+// A controller steers the snake: decide() is asked for the direction before
+// every tick, reset() (if set) is called when a new game starts
+typedef struct {
+  const char *name;
+  void (*reset)();
+  Direction (*decide)();
+} SnakeController;
+
+// Path-finding agent state. The search buffers have one entry per grid
+// cell and are allocated with the grid, so a decision allocates nothing.
+// Cells are marked visited with the current search's stamp, which saves
+// clearing the visited grid before every search.
+typedef struct {
+  int *queue;        // BFS frontier, every cell is queued at most once
+  Uint32 *visited;   // Stamp of the last search that reached each cell
+  Uint8 *came_from;  // Direction each reached cell was entered with
+  Uint8 *path;       // Planned moves from the head, in order
+  int capacity;      // Cells the buffers were allocated for
+  Uint32 stamp;      // Stamp of the current search
+  int path_length;   // Moves in path
+  int path_pos;      // Next move to take
+  int path_target;   // Food cell the path leads to, -1 if not reusable
+  long long searches;
+  long long decisions;
+  Uint64 planner_ticks; // Performance counter ticks spent deciding
+} PathPlanner;
+
+PathPlanner planner = {0};
+
+// Text rendering: the printable ASCII glyphs are rasterized once into an
+// atlas texture and strings are drawn from it as batches of quads
+#define GLYPH_FIRST 32
+#define GLYPH_LAST 126
+#define GLYPH_COUNT (GLYPH_LAST - GLYPH_FIRST + 1)
+#define ATLAS_WIDTH 512
+#define MAX_TEXT_LENGTH 128
+
+typedef struct {
+  SDL_Texture *texture;
+  int width, height;
+  SDL_Rect glyphs[GLYPH_COUNT]; // Where each glyph sits in the atlas
+  int advance[GLYPH_COUNT];     // How far the pen moves after each glyph
+} GlyphAtlas;
+
+GlyphAtlas text_atlas = {0};
+int text_allocations = 0;   // Surfaces/textures created for text so far
+bool show_text_stats = false; // Print text allocations once a second
 
 // Function prototypes
 void initializeGame();
 void cleanupGame();
-SnakeSegment *createSegment(int x, int y, SDL_Color color);
+bool allocSnake(int capacity);
+void resetOccupancy();
+Cell *snakeSegment(int i);
 void insertHead(int x, int y);
 void deleteTail();
 void updatePositions();
-void generateFood();
-// bool checkCollisionWithSelf();
+void updateGame();
+bool generateFood();
+bool checkCollisionWithSelf();
 bool checkCollisionWithWall();
 bool checkCollisionWithFood();
+void freePlanner();
+Direction keyboardDecide();
+void pathAgentReset();
+Direction pathAgentDecide();
+void runHeadless(int games, unsigned int seed);
+void updateCamera();
 void renderSnake(SDL_Renderer *renderer);
+void renderWorldBorder(SDL_Renderer *renderer);
+void renderScene(SDL_Renderer *renderer, TTF_Font *font);
+void benchmarkRender();
+int randomBelow(int n);
+Direction cycleDirection(int x, int y);
+void benchmarkMoves();
+void stressFill();
 void renderFood(SDL_Renderer *renderer);
+bool buildGlyphAtlas(SDL_Renderer *renderer, TTF_Font *font);
+void freeGlyphAtlas();
+int measureText(const char *text);
+int layoutText(const char *text, SDL_Color color, int x, int y,
+               SDL_Vertex *vertices);
+void drawTextVertices(SDL_Renderer *renderer, const SDL_Vertex *vertices,
+                      int vertex_count);
 void renderScore(SDL_Renderer *renderer, TTF_Font *font);
 void renderGameOver(SDL_Renderer *renderer, TTF_Font *font);
 
+// Controllers the snake can be played with, picked with --agent
+SnakeController keyboard_controller = {"keyboard", NULL, keyboardDecide};
+SnakeController path_controller = {"bfs", pathAgentReset, pathAgentDecide};
+SnakeController *controller = &keyboard_controller;
+
 // Initialize the snake with initial segments
 void initializeGame() {
-  // Seed random number generator
-  srand(time(NULL));
-
-  // Clear any existing snake
-  SnakeSegment *current = snake_head;
-  while (current != NULL) {
-    SnakeSegment *temp = current;
-    current = current->next;
-    free(temp);
+  // One ring buffer entry per grid cell, kept across games
+  if (snake.capacity != grid_cols * grid_rows &&
+      !allocSnake(grid_cols * grid_rows)) {
+    exit(1);
   }
-
-  snake_head = NULL;
-  snake_tail = NULL;
-
-  // Create initial snake segments
-  SDL_Color head_color = {0, 255, 0, 255}; // Green for head
-  SDL_Color body_color = {0, 200, 0, 255}; // Darker green for body
-
-  // Create initial snake at the center of the screen, heading right
-  int start_x = (SCREEN_WIDTH / GRID_SIZE / 2) * GRID_SIZE;
-  int start_y = (SCREEN_HEIGHT / GRID_SIZE / 2) * GRID_SIZE;
-
-  // Create head
-  snake_head = createSegment(start_x, start_y, head_color);
-  snake_tail = snake_head;
-
-  // Create body segments
-  for (int i = 1; i < INITIAL_LENGTH; i++) {
-    // Add segments to the left of the head
-    SnakeSegment *new_segment =
-        createSegment(start_x - i * GRID_SIZE, start_y, body_color);
-    new_segment->next = snake_head;
-    snake_head->prev = new_segment;
-    snake_head = new_segment;
+  resetOccupancy();
+
+  // Create initial snake at the center of the grid, heading right. The
+  // tail goes in first so the head ends up at the center.
+  int start_x = grid_cols / 2;
+  int start_y = grid_rows / 2;
+  for (int i = INITIAL_LENGTH - 1; i >= 0; i--) {
+    insertHead(start_x - i, start_y);
   }
 
   // Reset game state
@@ -103,80 +192,128 @@ void initializeGame() {
 
   // Generate initial food
   generateFood();
+
+  if (controller->reset != NULL) {
+    controller->reset();
+  }
 }
 
-// Clean up the snake linked list
+// Release the snake body and the occupancy tracking
 void cleanupGame() {
-  SnakeSegment *current = snake_head;
-  while (current != NULL) {
-    SnakeSegment *temp = current;
-    current = current->next;
-    free(temp);
+  free(snake.cells);
+  free(occupied);
+  free(free_cells);
+  free(free_slot);
+  freePlanner();
+  snake = (SnakeBody){0};
+  occupied = NULL;
+  free_cells = NULL;
+  free_slot = NULL;
+  free_count = 0;
+}
+
+// Allocate the ring buffer and occupancy tracking for a grid of capacity
+// cells
+bool allocSnake(int capacity) {
+  cleanupGame();
+  snake.cells = (Cell *)malloc(capacity * sizeof(Cell));
+  occupied = (Uint64 *)malloc((capacity + 63) / 64 * sizeof(Uint64));
+  free_cells = (int *)malloc(capacity * sizeof(int));
+  free_slot = (int *)malloc(capacity * sizeof(int));
+  if (snake.cells == NULL || occupied == NULL || free_cells == NULL ||
+      free_slot == NULL) {
+    fprintf(stderr, "Failed to allocate memory for the snake\n");
+    cleanupGame();
+    return false;
   }
-  snake_head = NULL;
-  snake_tail = NULL;
+  snake.capacity = capacity;
+  return true;
 }
 
-// Create a new snake segment
-SnakeSegment *createSegment(int x, int y, SDL_Color color) {
-  SnakeSegment *segment = (SnakeSegment *)malloc(sizeof(SnakeSegment));
-  if (segment == NULL) {
-    fprintf(stderr, "Failed to allocate memory for snake segment\n");
-    exit(1);
+// Empty the snake and mark every cell free
+void resetOccupancy() {
+  snake.head = 0;
+  snake.length = 0;
+  head_on_body = false;
+
+  memset(occupied, 0, (snake.capacity + 63) / 64 * sizeof(Uint64));
+  for (int i = 0; i < snake.capacity; i++) {
+    free_cells[i] = i;
+    free_slot[i] = i;
   }
+  free_count = snake.capacity;
+}
 
-  segment->x = x;
-  segment->y = y;
-  segment->color = color;
-  segment->prev = NULL;
-  segment->next = NULL;
+// Check if a cell is inside the grid
+static inline bool cellInGrid(int x, int y) {
+  return x >= 0 && x < grid_cols && y >= 0 && y < grid_rows;
+}
 
-  return segment;
+// Check if a cell in the grid is under the snake
+static inline bool isOccupied(int cell) {
+  return (occupied[cell >> 6] >> (cell & 63)) & 1;
 }
 
-// Insert a new segment at the head of the snake
-void insertHead(int x, int y) {
-  SDL_Color head_color = {0, 255, 0, 255}; // Green for head
-  SDL_Color body_color = {0, 200, 0, 255}; // Darker green for body
+// Mark a free cell as under the snake
+static void occupyCell(int cell) {
+  occupied[cell >> 6] |= (Uint64)1 << (cell & 63);
 
-  // Change current head color to body color
-  if (snake_head != NULL) {
-    snake_head->color = body_color;
-  }
+  // Fill its place in the free list with the last entry
+  int slot = free_slot[cell];
+  int last = free_cells[--free_count];
+  free_cells[slot] = last;
+  free_slot[last] = slot;
+  free_slot[cell] = -1;
+}
 
-  // Create new head
-  SnakeSegment *new_head = createSegment(x, y, head_color);
+// Hand a cell the snake left back to the free list
+static void releaseCell(int cell) {
+  occupied[cell >> 6] &= ~((Uint64)1 << (cell & 63));
+  free_cells[free_count] = cell;
+  free_slot[cell] = free_count++;
+}
 
-  // Insert at the beginning of the list
-  if (snake_head == NULL) {
-    snake_head = new_head;
-    snake_tail = new_head;
-  } else {
-    new_head->next = snake_head;
-    snake_head->prev = new_head;
-    snake_head = new_head;
+// Segment i of the snake, counting back from the head (0)
+Cell *snakeSegment(int i) {
+  int index = snake.head + i;
+  if (index >= snake.capacity) {
+    index -= snake.capacity;
+  }
+  return &snake.cells[index];
+}
+
+// Insert a new segment at the head of the snake
+void insertHead(int x, int y) {
+  if (snake.length == snake.capacity) {
+    // Growing on a full grid, the move ends the game whichever cell it is
+    // in. The tail's entry is reused so the collision checks see the head.
+    snake.length--;
+  }
+  snake.head = (snake.head == 0) ? snake.capacity - 1 : snake.head - 1;
+  snake.cells[snake.head] = (Cell){x, y};
+  snake.length++;
+
+  // A head outside the grid is caught by the wall check instead
+  if (cellInGrid(x, y)) {
+    int cell = y * grid_cols + x;
+    if (isOccupied(cell)) {
+      head_on_body = true;
+    } else {
+      occupyCell(cell);
+    }
   }
 }
 
 // Delete the tail segment
 void deleteTail() {
-  if (snake_tail == NULL) {
+  if (snake.length == 0) {
     return;
   }
-
-  if (snake_head == snake_tail) {
-    // Only one segment
-    free(snake_tail);
-    snake_head = NULL;
-    snake_tail = NULL;
-    return;
+  Cell *tail = snakeSegment(snake.length - 1);
+  if (cellInGrid(tail->x, tail->y)) {
+    releaseCell(tail->y * grid_cols + tail->x);
   }
-
-  // Multiple segments
-  SnakeSegment *new_tail = snake_tail->prev;
-  new_tail->next = NULL;
-  free(snake_tail);
-  snake_tail = new_tail;
+  snake.length--;
 }
 
 // Update the positions of all snake segments
@@ -186,173 +323,1010 @@ void updatePositions() {
   }
 
   // Calculate new head position based on current direction
-  int new_x = snake_head->x;
-  int new_y = snake_head->y;
+  Cell head = snake.cells[snake.head];
+  int new_x = head.x;
+  int new_y = head.y;
 
   switch (current_direction) {
   case UP:
-    new_y -= GRID_SIZE;
+    new_y--;
     break;
   case RIGHT:
-    new_x += GRID_SIZE;
+    new_x++;
     break;
   case DOWN:
-    new_y += GRID_SIZE;
+    new_y++;
     break;
   case LEFT:
-    new_x -= GRID_SIZE;
+    new_x--;
     break;
   }
 
-  // Insert new head
-  insertHead(new_x, new_y);
-
-  // Delete tail if not growing
+  // Delete tail if not growing, first so the buffer always has room
   if (!should_grow) {
     deleteTail();
   } else {
     should_grow = false; // Reset growth flag
   }
+
+  // Insert new head
+  insertHead(new_x, new_y);
 }
 
-// Generate a new food item at a random position
-void generateFood() {
-  // Generate random position
-  int max_x = SCREEN_WIDTH / GRID_SIZE - 1;
-  int max_y = SCREEN_HEIGHT / GRID_SIZE - 1;
+// Advance the game by one fixed tick: move, then resolve collisions
+void updateGame() {
+  // Update direction, from the keys or the agent
+  next_direction = controller->decide();
+  current_direction = next_direction;
 
-  // Try to place food in a position not occupied by the snake
-  bool valid_position = false;
-  int x, y;
+  // Update snake position
+  updatePositions();
 
-  while (!valid_position) {
-    valid_position = true;
-    x = (rand() % max_x) * GRID_SIZE;
-    y = (rand() % max_y) * GRID_SIZE;
+  // Check for collisions
+  if (checkCollisionWithWall() || checkCollisionWithSelf()) {
+    game_over = true;
+    return;
+  }
 
-    // Check if this position collides with snake
-    SnakeSegment *current = snake_head;
-    while (current != NULL) {
-      if (current->x == x && current->y == y) {
-        valid_position = false;
-        break;
-      }
-      current = current->next;
+  // Check if snake ate food, the game ends when the snake fills the grid
+  if (checkCollisionWithFood()) {
+    score++;
+    should_grow = true;
+    if (!generateFood()) {
+      game_over = true;
     }
   }
+}
+
+// Random number in 0..n-1. Two rand() calls are combined where RAND_MAX is
+// as small as 32767, so every cell of a large world can come up.
+int randomBelow(int n) {
+  unsigned int r = rand();
+  if (RAND_MAX < n) {
+    r = r * ((unsigned int)RAND_MAX + 1) + rand();
+  }
+  return r % n;
+}
 
-  food.x = x;
-  food.y = y;
+// Generate a new food item in a random free cell. Returns false when the
+// snake covers the whole grid and there is nowhere left to put it.
+bool generateFood() {
   food.color = (SDL_Color){255, 0, 0, 255}; // Red color for food
+  if (free_count == 0) {
+    food.x = -1;
+    food.y = -1;
+    return false;
+  }
+
+  // Every free cell is equally likely, whatever the snake's length
+  int cell = free_cells[randomBelow(free_count)];
+  food.x = cell % grid_cols;
+  food.y = cell / grid_cols;
+  return true;
 }
 
-// Check if snake head collides with its own body
-// bool checkCollisionWithSelf() {
-//     SnakeSegment *current = snake_head->next; // Start with the segment after
-//     the head
-//
-//     while (current != NULL) {
-//         if (snake_head->x == current->x && snake_head->y == current->y) {
-//             return true; // Collision detected
-//         }
-//         current = current->next;
-//     }
-//
-//     return false; // No collision
-// }
+// Check if snake head collides with its own body. insertHead() already
+// looked the new head's cell up in the occupancy bitmap.
+bool checkCollisionWithSelf() { return head_on_body; }
 
 // Check if snake head collides with wall
 bool checkCollisionWithWall() {
-  return (snake_head->x < 0 || snake_head->x >= SCREEN_WIDTH ||
-          snake_head->y < 0 || snake_head->y >= SCREEN_HEIGHT);
+  Cell head = snake.cells[snake.head];
+  return (head.x < 0 || head.x >= grid_cols || head.y < 0 ||
+          head.y >= grid_rows);
 }
 
 // Check if snake head collides with food
 bool checkCollisionWithFood() {
-  return (snake_head->x == food.x && snake_head->y == food.y);
+  Cell head = snake.cells[snake.head];
+  return (head.x == food.x && head.y == food.y);
+}
+
+// Keyboard control: the direction the last arrow key asked for
+Direction keyboardDecide() { return next_direction; }
+
+// Release the agent's search buffers
+void freePlanner() {
+  free(planner.queue);
+  free(planner.visited);
+  free(planner.came_from);
+  free(planner.path);
+  planner = (PathPlanner){0};
+}
+
+// New game: size the search buffers for the grid and drop the old path.
+// The statistics carry on across games.
+void pathAgentReset() {
+  int cells = grid_cols * grid_rows;
+  if (planner.capacity != cells) {
+    long long searches = planner.searches, decisions = planner.decisions;
+    Uint64 planner_ticks = planner.planner_ticks;
+    freePlanner();
+    planner.queue = (int *)malloc(cells * sizeof(int));
+    planner.visited = (Uint32 *)calloc(cells, sizeof(Uint32));
+    planner.came_from = (Uint8 *)malloc(cells);
+    planner.path = (Uint8 *)malloc(cells);
+    if (planner.queue == NULL || planner.visited == NULL ||
+        planner.came_from == NULL || planner.path == NULL) {
+      fprintf(stderr, "Failed to allocate memory for the snake agent\n");
+      exit(1);
+    }
+    planner.capacity = cells;
+    planner.searches = searches;
+    planner.decisions = decisions;
+    planner.planner_ticks = planner_ticks;
+  }
+  planner.path_length = 0;
+  planner.path_pos = 0;
+  planner.path_target = -1;
 }
 
-// Render the snake
+// Cell a step away in a direction, -1 outside the grid
+static int stepCell(int cell, Direction direction) {
+  int x = cell % grid_cols, y = cell / grid_cols;
+  switch (direction) {
+  case UP:
+    return y > 0 ? cell - grid_cols : -1;
+  case RIGHT:
+    return x < grid_cols - 1 ? cell + 1 : -1;
+  case DOWN:
+    return y < grid_rows - 1 ? cell + grid_cols : -1;
+  case LEFT:
+    return x > 0 ? cell - 1 : -1;
+  }
+  return -1;
+}
+
+// Check if the head can move into a cell next tick. The tail moves out of
+// its cell on the same tick unless the snake is growing.
+static bool cellPassable(int cell, int tail) {
+  return !isOccupied(cell) || (cell == tail && !should_grow);
+}
+
+// Breadth-first search over passable cells from the head to target, which
+// may itself be occupied (the tail). On success the moves are written to
+// the planner's path. Grid moves all cost the same, so the first time BFS
+// reaches the target is along a shortest path.
+static bool planPath(int start, int target, int tail) {
+  planner.searches++;
+  if (++planner.stamp == 0) {
+    // Stamps wrapped around, old marks could look current
+    memset(planner.visited, 0, planner.capacity * sizeof(Uint32));
+    planner.stamp = 1;
+  }
+
+  int head = 0, count = 0;
+  planner.queue[count++] = start;
+  planner.visited[start] = planner.stamp;
+  bool found = false;
+  while (head < count && !found) {
+    int cell = planner.queue[head++];
+    for (int d = 0; d < 4; d++) {
+      int next = stepCell(cell, (Direction)d);
+      if (next < 0 || planner.visited[next] == planner.stamp) {
+        continue;
+      }
+      if (next != target && !cellPassable(next, tail)) {
+        continue;
+      }
+      planner.visited[next] = planner.stamp;
+      planner.came_from[next] = d;
+      if (next == target) {
+        found = true;
+        break;
+      }
+      planner.queue[count++] = next;
+    }
+  }
+  if (!found) {
+    return false;
+  }
+
+  // Walk back from the target to size the path, then fill it in forwards
+  int length = 0;
+  for (int cell = target; cell != start;
+       cell = stepCell(cell, (Direction)((planner.came_from[cell] + 2) % 4))) {
+    length++;
+  }
+  int i = length;
+  for (int cell = target; cell != start;
+       cell = stepCell(cell, (Direction)((planner.came_from[cell] + 2) % 4))) {
+    planner.path[--i] = planner.came_from[cell];
+  }
+  planner.path_length = length;
+  planner.path_pos = 0;
+  return true;
+}
+
+// Path-finding agent: follow a shortest path to the food around the body.
+// The path stays valid until the food is eaten, since the only cells the
+// snake takes over meanwhile are the path's own, so it is planned once per
+// food. With no way to the food it chases its tail, which keeps space open
+// until the food can be reached, and failing that takes any free cell.
+Direction pathAgentDecide() {
+  Uint64 start = SDL_GetPerformanceCounter();
+  planner.decisions++;
+
+  Cell head_cell = snake.cells[snake.head];
+  Cell *tail_cell = snakeSegment(snake.length - 1);
+  int head = head_cell.y * grid_cols + head_cell.x;
+  int tail = tail_cell->y * grid_cols + tail_cell->x;
+  int food_cell = food.x >= 0 ? food.y * grid_cols + food.x : -1;
+  Direction direction = current_direction;
+
+  if (food_cell >= 0 && planner.path_target == food_cell &&
+      planner.path_pos < planner.path_length) {
+    direction = (Direction)planner.path[planner.path_pos++];
+  } else if (food_cell >= 0 && planPath(head, food_cell, tail)) {
+    planner.path_target = food_cell;
+    direction = (Direction)planner.path[planner.path_pos++];
+  } else if (snake.length > 1 && planPath(head, tail, tail)) {
+    // The tail moves every tick, so this path is only good for one move
+    planner.path_target = -1;
+    direction = (Direction)planner.path[0];
+  } else {
+    // Boxed in: take the free neighbour with the most room around it
+    int best_room = -1;
+    for (int d = 0; d < 4; d++) {
+      int next = stepCell(head, (Direction)d);
+      if (next < 0 || !cellPassable(next, tail)) {
+        continue;
+      }
+      int room = 0;
+      for (int e = 0; e < 4; e++) {
+        int around = stepCell(next, (Direction)e);
+        room += around >= 0 && !isOccupied(around);
+      }
+      if (room > best_room) {
+        best_room = room;
+        direction = (Direction)d;
+      }
+    }
+    planner.path_target = -1;
+  }
+
+  planner.planner_ticks += SDL_GetPerformanceCounter() - start;
+  return direction;
+}
+
+// Play games back to back with the current controller and no window. Each
+// game ends on a collision, a full grid, or when the snake goes a whole
+// grid's worth of ticks twice over without eating.
+void runHeadless(int games, unsigned int seed) {
+  srand(seed);
+  long long total_score = 0, total_ticks = 0;
+  int best_score = 0, full_grids = 0, stalls = 0;
+  Uint64 start = SDL_GetPerformanceCounter();
+
+  for (int game = 0; game < games; game++) {
+    initializeGame();
+    long long ticks = 0, last_meal = 0;
+    int last_score = 0;
+    long long stall_limit = 2LL * grid_cols * grid_rows;
+    while (!game_over) {
+      updateGame();
+      ticks++;
+      if (score != last_score) {
+        last_score = score;
+        last_meal = ticks;
+      } else if (ticks - last_meal > stall_limit) {
+        stalls++;
+        break;
+      }
+    }
+
+    if (food.x < 0) {
+      full_grids++;
+    }
+    total_score += score;
+    total_ticks += ticks;
+    if (score > best_score) {
+      best_score = score;
+    }
+  }
+
+  double frequency = (double)SDL_GetPerformanceFrequency();
+  double seconds = (SDL_GetPerformanceCounter() - start) / frequency;
+  printf("games: %d  seed: %u  world: %dx%d  controller: %s\n", games, seed,
+         grid_cols, grid_rows, controller->name);
+  printf("average score: %.1f  best: %d  full grids: %d  stalled: %d\n",
+         games > 0 ? (double)total_score / games : 0.0, best_score,
+         full_grids, stalls);
+  printf("average ticks: %.0f  %.0f ticks/s  %.3f s\n",
+         games > 0 ? (double)total_ticks / games : 0.0,
+         seconds > 0 ? total_ticks / seconds : 0.0, seconds);
+  if (planner.decisions > 0) {
+    double planner_us = planner.planner_ticks * 1e6 / frequency;
+    printf("planner: %.3f us/decision  %.2f us/search  %lld searches\n",
+           planner_us / planner.decisions,
+           planner.searches > 0 ? planner_us / planner.searches : 0.0,
+           planner.searches);
+  }
+
+  cleanupGame();
+}
+
+// Center the camera on the head, keeping it inside the world. A world
+// smaller than the window is centered in it instead.
+void updateCamera() {
+  Cell head = snake.cells[snake.head];
+  int world_w = grid_cols * GRID_SIZE;
+  int world_h = grid_rows * GRID_SIZE;
+
+  if (world_w <= SCREEN_WIDTH) {
+    camera_x = (world_w - SCREEN_WIDTH) / 2;
+  } else {
+    camera_x = head.x * GRID_SIZE + GRID_SIZE / 2 - SCREEN_WIDTH / 2;
+    camera_x = camera_x < 0 ? 0 : camera_x;
+    camera_x = camera_x > world_w - SCREEN_WIDTH ? world_w - SCREEN_WIDTH
+                                                 : camera_x;
+  }
+
+  if (world_h <= SCREEN_HEIGHT) {
+    camera_y = (world_h - SCREEN_HEIGHT) / 2;
+  } else {
+    camera_y = head.y * GRID_SIZE + GRID_SIZE / 2 - SCREEN_HEIGHT / 2;
+    camera_y = camera_y < 0 ? 0 : camera_y;
+    camera_y = camera_y > world_h - SCREEN_HEIGHT ? world_h - SCREEN_HEIGHT
+                                                  : camera_y;
+  }
+}
+
+// Render the snake. Only the cells in view are looked at, in the occupancy
+// bitmap, so the cost depends on the window size and not on the snake's
+// length. Runs of body cells along a row become one rectangle, and a run
+// with the same span as one in the row above grows that rectangle down, so
+// straight stretches either way are merged. The whole body then goes out
+// in a single SDL_RenderFillRects call.
 void renderSnake(SDL_Renderer *renderer) {
-  SnakeSegment *current = snake_head;
+  SDL_Color head_color = {0, 255, 0, 255}; // Green for head
+  SDL_Color body_color = {0, 200, 0, 255}; // Darker green for body
+
+  // Visible cell range, clipped to the world
+  int first_col = camera_x > 0 ? camera_x / GRID_SIZE : 0;
+  int first_row = camera_y > 0 ? camera_y / GRID_SIZE : 0;
+  int last_col = (camera_x + SCREEN_WIDTH - 1) / GRID_SIZE;
+  int last_row = (camera_y + SCREEN_HEIGHT - 1) / GRID_SIZE;
+  last_col = last_col < grid_cols ? last_col : grid_cols - 1;
+  last_row = last_row < grid_rows ? last_row : grid_rows - 1;
+
+  static SDL_Rect rects[MAX_VISIBLE_CELLS];
+  int open[MAX_VISIBLE_COLS], next_open[MAX_VISIBLE_COLS]; // Rects per row
+  int open_count = 0;
+  int rect_count = 0;
+
+  for (int y = first_row; y <= last_row; y++) {
+    int next_count = 0;
+    int o = 0; // Next rect from the row above to match, they are in x order
+    int x = first_col;
+    while (x <= last_col) {
+      if (!isOccupied(y * grid_cols + x)) {
+        x++;
+        continue;
+      }
+      int run_start = x;
+      while (x <= last_col && isOccupied(y * grid_cols + x)) {
+        x++;
+      }
+
+      int rect_x = run_start * GRID_SIZE - camera_x;
+      int rect_w = (x - run_start) * GRID_SIZE;
+      while (o < open_count && rects[open[o]].x < rect_x) {
+        o++;
+      }
+      if (o < open_count && rects[open[o]].x == rect_x &&
+          rects[open[o]].w == rect_w) {
+        rects[open[o]].h += GRID_SIZE;
+        next_open[next_count++] = open[o++];
+      } else {
+        rects[rect_count] = (SDL_Rect){rect_x, y * GRID_SIZE - camera_y,
+                                       rect_w, GRID_SIZE};
+        next_open[next_count++] = rect_count++;
+      }
+    }
+    memcpy(open, next_open, next_count * sizeof(int));
+    open_count = next_count;
+  }
 
-  while (current != NULL) {
-    SDL_SetRenderDrawColor(renderer, current->color.r, current->color.g,
-                           current->color.b, current->color.a);
+  // Body first, the head is drawn over it
+  if (rect_count > 0) {
+    SDL_SetRenderDrawColor(renderer, body_color.r, body_color.g, body_color.b,
+                           body_color.a);
+    SDL_RenderFillRects(renderer, rects, rect_count);
+    draw_calls++;
+  }
 
-    SDL_Rect segment_rect = {current->x, current->y, GRID_SIZE, GRID_SIZE};
+  Cell head = snake.cells[snake.head];
+  SDL_SetRenderDrawColor(renderer, head_color.r, head_color.g, head_color.b,
+                         head_color.a);
+  SDL_Rect head_rect = {head.x * GRID_SIZE - camera_x,
+                        head.y * GRID_SIZE - camera_y, GRID_SIZE, GRID_SIZE};
+  SDL_RenderFillRect(renderer, &head_rect);
+  draw_calls++;
+}
 
-    SDL_RenderFillRect(renderer, &segment_rect);
+// Outline the world when it doesn't exactly fill the window
+void renderWorldBorder(SDL_Renderer *renderer) {
+  int world_w = grid_cols * GRID_SIZE;
+  int world_h = grid_rows * GRID_SIZE;
+  if (world_w == SCREEN_WIDTH && world_h == SCREEN_HEIGHT) {
+    return;
+  }
+  SDL_SetRenderDrawColor(renderer, 80, 80, 80, 255);
+  SDL_Rect border = {-camera_x - 1, -camera_y - 1, world_w + 2, world_h + 2};
+  SDL_RenderDrawRect(renderer, &border);
+  draw_calls++;
+}
 
-    current = current->next;
+// Draw everything that only changes when the game ticks
+void renderScene(SDL_Renderer *renderer, TTF_Font *font) {
+  // Clear screen
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+  SDL_RenderClear(renderer);
+
+  // Render game elements
+  updateCamera();
+  renderWorldBorder(renderer);
+  renderSnake(renderer);
+  renderFood(renderer);
+  renderScore(renderer, font);
+
+  // Render game over message if game is over
+  if (game_over) {
+    renderGameOver(renderer, font);
   }
 }
 
+// Direction that keeps the head on a cycle through every cell of the grid
+// (the grid needs an even number of rows). Row 0 runs right, the rows
+// below zigzag over columns 1 and up, and column 0 leads back to the top.
+Direction cycleDirection(int x, int y) {
+  if (x == 0) {
+    return y == 0 ? RIGHT : UP;
+  }
+  if (y % 2 == 0) {
+    return x == grid_cols - 1 ? DOWN : RIGHT;
+  }
+  if (x == 1) {
+    return y == grid_rows - 1 ? LEFT : DOWN;
+  }
+  return LEFT;
+}
+
+// Node of the old malloc-per-move linked list, kept only so the move
+// benchmark has something to compare against
+typedef struct ListSegment {
+  int x, y;
+  struct ListSegment *prev, *next;
+} ListSegment;
+
+// Move a linked-list snake along cycleDirection(), a malloc'd node per move
+// and a free per tail. With occupancy set it also does the same bitmap and
+// free-cell upkeep as insertHead() and deleteTail(). Returns the seconds.
+double timeListMoves(ListSegment **head, ListSegment **tail, int moves,
+                     bool occupancy) {
+  Uint64 start = SDL_GetPerformanceCounter();
+  for (int i = 0; i < moves; i++) {
+    ListSegment *old_tail = *tail;
+    if (occupancy) {
+      releaseCell(old_tail->y * grid_cols + old_tail->x);
+    }
+    *tail = old_tail->prev;
+    (*tail)->next = NULL;
+    free(old_tail);
+
+    Direction direction = cycleDirection((*head)->x, (*head)->y);
+    ListSegment *node = (ListSegment *)malloc(sizeof(ListSegment));
+    node->x = (*head)->x + (direction == RIGHT) - (direction == LEFT);
+    node->y = (*head)->y + (direction == DOWN) - (direction == UP);
+    node->prev = NULL;
+    node->next = *head;
+    (*head)->prev = node;
+    *head = node;
+    if (occupancy) {
+      int cell = node->y * grid_cols + node->x;
+      if (isOccupied(cell)) {
+        head_on_body = true;
+      } else {
+        occupyCell(cell);
+      }
+    }
+  }
+  return (SDL_GetPerformanceCounter() - start) /
+         (double)SDL_GetPerformanceFrequency();
+}
+
+// Moves per second at different snake lengths, for the ring buffer and for
+// the old linked list. The snake follows cycleDirection() on a 1000x1000
+// grid so it never runs into itself. The ring always keeps the occupancy
+// up to date, so the list is timed both bare and doing the same upkeep.
+void benchmarkMoves() {
+  const int lengths[] = {10, 1000, 100000};
+  const int moves = 2000000;
+  double frequency = (double)SDL_GetPerformanceFrequency();
+
+  grid_cols = 1000;
+  grid_rows = 1000;
+  if (!allocSnake(grid_cols * grid_rows)) {
+    return;
+  }
+
+  printf("%-8s %16s %16s %16s %14s\n", "length", "ring moves/s",
+         "list moves/s", "list+occ moves/s", "occupancy ns");
+  for (int l = 0; l < 3; l++) {
+    // Grow the snake to length along the cycle, then time plain moves
+    resetOccupancy();
+    insertHead(0, 0);
+    for (int i = 1; i < lengths[l]; i++) {
+      Cell head = snake.cells[snake.head];
+      current_direction = cycleDirection(head.x, head.y);
+      should_grow = true;
+      updatePositions();
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < moves; i++) {
+      Cell head = snake.cells[snake.head];
+      current_direction = cycleDirection(head.x, head.y);
+      updatePositions();
+    }
+    double ring_seconds = (SDL_GetPerformanceCounter() - start) / frequency;
+
+    // Same walk on the list, first bare
+    ListSegment *head = NULL, *tail = NULL;
+    for (int i = snake.length - 1; i >= 0; i--) {
+      ListSegment *node = (ListSegment *)malloc(sizeof(ListSegment));
+      *node = (ListSegment){snakeSegment(i)->x, snakeSegment(i)->y, NULL,
+                            head};
+      if (head != NULL) {
+        head->prev = node;
+      } else {
+        tail = node;
+      }
+      head = node;
+    }
+    double list_seconds = timeListMoves(&head, &tail, moves, false);
+
+    // Then with the occupancy rebuilt for where the list body is now
+    resetOccupancy();
+    for (ListSegment *node = head; node != NULL; node = node->next) {
+      occupyCell(node->y * grid_cols + node->x);
+    }
+    double occupancy_seconds = timeListMoves(&head, &tail, moves, true);
+
+    while (head != NULL) {
+      ListSegment *next = head->next;
+      free(head);
+      head = next;
+    }
+
+    printf("%-8d %16.0f %16.0f %16.0f %14.2f%s\n", lengths[l],
+           moves / ring_seconds, moves / list_seconds,
+           moves / occupancy_seconds,
+           (occupancy_seconds - list_seconds) * 1e9 / moves,
+           head_on_body ? "  (self collision!)" : "");
+  }
+
+  cleanupGame();
+}
+
+// Fill a 1000x1000 grid to completion: the snake grows on every move
+// along cycleDirection() and food is placed again after every move, until
+// there is no free cell left. Checks the occupancy tracking against the
+// body on the way and that both ways of ending a full board are caught.
+void stressFill() {
+  grid_cols = 1000;
+  grid_rows = 1000;
+  if (!allocSnake(grid_cols * grid_rows)) {
+    return;
+  }
+  resetOccupancy();
+  insertHead(0, 0);
+  generateFood();
+
+  int placements = 1;
+  bool ok = true;
+  Uint64 start = SDL_GetPerformanceCounter();
+  while (free_count > 0) {
+    Cell head = snake.cells[snake.head];
+    current_direction = cycleDirection(head.x, head.y);
+    should_grow = true;
+    updatePositions();
+    if (checkCollisionWithSelf()) {
+      ok = false;
+      break;
+    }
+    if (generateFood()) {
+      placements++;
+      if (isOccupied(food.y * grid_cols + food.x)) {
+        ok = false;
+        break;
+      }
+    }
+  }
+  double seconds = (SDL_GetPerformanceCounter() - start) /
+                   (double)SDL_GetPerformanceFrequency();
+
+  // Full board: no food, growing into the tail is a collision, but a
+  // plain move follows the tail out
+  ok = ok && snake.length == snake.capacity && !generateFood();
+  Cell head = snake.cells[snake.head];
+  current_direction = cycleDirection(head.x, head.y);
+  should_grow = false;
+  updatePositions();
+  ok = ok && !checkCollisionWithSelf();
+  head = snake.cells[snake.head];
+  current_direction = cycleDirection(head.x, head.y);
+  should_grow = true;
+  updatePositions();
+  ok = ok && checkCollisionWithSelf();
+
+  printf("grid: %dx%d  length: %d  food placements: %d\n", grid_cols,
+         grid_rows, snake.length, placements);
+  printf("%.3f s  %.0f moves+placements/s  %s\n", seconds,
+         seconds > 0 ? placements / seconds : 0.0, ok ? "ok" : "FAILED");
+
+  cleanupGame();
+}
+
+// Draw calls and CPU time per frame for a 1000-segment snake, drawn one
+// rectangle per segment as before, with merged runs, and from the cached
+// scene on frames without a tick. The snake follows cycleDirection() on a
+// 60x60 world. Renders into an offscreen surface so no window is needed.
+void benchmarkRender() {
+  const int length = 1000;
+  const int frames = 1000;
+  double frequency = (double)SDL_GetPerformanceFrequency();
+
+  SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(
+      0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+  SDL_Renderer *renderer = target ? SDL_CreateSoftwareRenderer(target) : NULL;
+  if (renderer == NULL) {
+    printf("Could not create software renderer: %s\n", SDL_GetError());
+    SDL_FreeSurface(target);
+    return;
+  }
+
+  grid_cols = 60;
+  grid_rows = 60;
+  if (!allocSnake(grid_cols * grid_rows)) {
+    return;
+  }
+  resetOccupancy();
+  insertHead(0, 0);
+  for (int i = 1; i < length; i++) {
+    Cell head = snake.cells[snake.head];
+    current_direction = cycleDirection(head.x, head.y);
+    should_grow = true;
+    updatePositions();
+  }
+  updateCamera();
+
+  // Scene cache as the game loop keeps it, filled once up front
+  SDL_Texture *cache =
+      SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                        SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+  if (cache != NULL) {
+    SDL_SetRenderTarget(renderer, cache);
+    renderSnake(renderer);
+    SDL_SetRenderTarget(renderer, NULL);
+  }
+
+  printf("snake length %d, %d frames\n", length, frames);
+  printf("%-10s %16s %14s\n", "method", "draw calls/frame", "us/frame");
+  const char *names[] = {"segments", "merged", "cached"};
+  for (int method = 0; method < 3; method++) {
+    draw_calls = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int f = 0; f < frames; f++) {
+      if (method == 0) {
+        // The old way: every segment on its own, visible or not
+        for (int i = snake.length - 1; i >= 0; i--) {
+          Cell *segment = snakeSegment(i);
+          SDL_Rect rect = {segment->x * GRID_SIZE - camera_x,
+                           segment->y * GRID_SIZE - camera_y, GRID_SIZE,
+                           GRID_SIZE};
+          SDL_SetRenderDrawColor(renderer, 0, i ? 200 : 255, 0, 255);
+          SDL_RenderFillRect(renderer, &rect);
+          draw_calls++;
+        }
+      } else if (method == 1) {
+        renderSnake(renderer);
+      } else {
+        // A frame between ticks draws nothing but the cached scene
+        SDL_RenderCopy(renderer, cache, NULL, NULL);
+        draw_calls++;
+      }
+    }
+    double seconds = (SDL_GetPerformanceCounter() - start) / frequency;
+    printf("%-10s %16.1f %14.2f\n", names[method], (double)draw_calls / frames,
+           seconds * 1e6 / frames);
+  }
+  draw_calls = 0;
+
+  if (cache != NULL) {
+    SDL_DestroyTexture(cache);
+  }
+  cleanupGame();
+  SDL_DestroyRenderer(renderer);
+  SDL_FreeSurface(target);
+}
+
 // Render the food
 void renderFood(SDL_Renderer *renderer) {
+  if (food.x < 0) {
+    return; // No food once the grid is full
+  }
+
   SDL_SetRenderDrawColor(renderer, food.color.r, food.color.g, food.color.b,
                          food.color.a);
 
-  SDL_Rect food_rect = {food.x, food.y, GRID_SIZE, GRID_SIZE};
+  SDL_Rect food_rect = {food.x * GRID_SIZE - camera_x,
+                       food.y * GRID_SIZE - camera_y, GRID_SIZE, GRID_SIZE};
 
   SDL_RenderFillRect(renderer, &food_rect);
+  draw_calls++;
 }
 
-// Render the score
-void renderScore(SDL_Renderer *renderer, TTF_Font *font) {
-  char score_text[32];
-  sprintf(score_text, "Score: %d", score);
-
+// Rasterize every printable glyph into the atlas texture
+bool buildGlyphAtlas(SDL_Renderer *renderer, TTF_Font *font) {
   SDL_Color white = {255, 255, 255, 255};
-  SDL_Surface *text_surface = TTF_RenderText_Solid(font, score_text, white);
-  if (!text_surface) {
-    printf("Failed to render text: %s\n", TTF_GetError());
-    return;
+  SDL_Surface *glyph_surfaces[GLYPH_COUNT];
+
+  // Render the glyphs and pack them into rows
+  int pen_x = 0, pen_y = 0, row_height = 0;
+  for (int i = 0; i < GLYPH_COUNT; i++) {
+    Uint16 ch = GLYPH_FIRST + i;
+    glyph_surfaces[i] = TTF_RenderGlyph_Blended(font, ch, white);
+    if (glyph_surfaces[i] != NULL) {
+      text_allocations++;
+    }
+
+    int advance = 0;
+    TTF_GlyphMetrics(font, ch, NULL, NULL, NULL, NULL, &advance);
+    text_atlas.advance[i] = advance;
+
+    int w = glyph_surfaces[i] ? glyph_surfaces[i]->w : 0;
+    int h = glyph_surfaces[i] ? glyph_surfaces[i]->h : 0;
+    if (pen_x + w > ATLAS_WIDTH) {
+      pen_x = 0;
+      pen_y += row_height;
+      row_height = 0;
+    }
+    text_atlas.glyphs[i] = (SDL_Rect){pen_x, pen_y, w, h};
+    pen_x += w;
+    if (h > row_height) {
+      row_height = h;
+    }
+  }
+
+  text_atlas.width = ATLAS_WIDTH;
+  text_atlas.height = pen_y + row_height;
+
+  SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(
+      0, text_atlas.width, text_atlas.height, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!atlas) {
+    printf("Failed to create glyph atlas: %s\n", SDL_GetError());
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+      SDL_FreeSurface(glyph_surfaces[i]);
+    }
+    return false;
+  }
+  text_allocations++;
+
+  // Copy the glyphs in, keeping their alpha as is
+  for (int i = 0; i < GLYPH_COUNT; i++) {
+    if (glyph_surfaces[i] == NULL) {
+      continue;
+    }
+    SDL_SetSurfaceBlendMode(glyph_surfaces[i], SDL_BLENDMODE_NONE);
+    SDL_BlitSurface(glyph_surfaces[i], NULL, atlas, &text_atlas.glyphs[i]);
+    SDL_FreeSurface(glyph_surfaces[i]);
   }
 
-  SDL_Texture *text_texture =
-      SDL_CreateTextureFromSurface(renderer, text_surface);
-  if (!text_texture) {
+  text_atlas.texture = SDL_CreateTextureFromSurface(renderer, atlas);
+  SDL_FreeSurface(atlas);
+  if (!text_atlas.texture) {
     printf("Failed to create texture: %s\n", SDL_GetError());
-    SDL_FreeSurface(text_surface);
+    return false;
+  }
+  text_allocations++;
+  SDL_SetTextureBlendMode(text_atlas.texture, SDL_BLENDMODE_BLEND);
+  return true;
+}
+
+// Release the atlas texture
+void freeGlyphAtlas() {
+  if (text_atlas.texture != NULL) {
+    SDL_DestroyTexture(text_atlas.texture);
+  }
+  text_atlas = (GlyphAtlas){0};
+}
+
+// Width of a string in pixels when drawn from the atlas
+int measureText(const char *text) {
+  int width = 0;
+  for (int i = 0; text[i] != '\0' && i < MAX_TEXT_LENGTH; i++) {
+    int ch = (unsigned char)text[i];
+    if (ch < GLYPH_FIRST || ch > GLYPH_LAST) {
+      ch = '?';
+    }
+    width += text_atlas.advance[ch - GLYPH_FIRST];
+  }
+  return width;
+}
+
+// Build the quads for a string. Returns the number of vertices written.
+int layoutText(const char *text, SDL_Color color, int x, int y,
+               SDL_Vertex *vertices) {
+  float inv_w = 1.0f / text_atlas.width;
+  float inv_h = 1.0f / text_atlas.height;
+  int count = 0;
+  int pen_x = x;
+
+  for (int i = 0; text[i] != '\0' && i < MAX_TEXT_LENGTH; i++) {
+    int ch = (unsigned char)text[i];
+    if (ch < GLYPH_FIRST || ch > GLYPH_LAST) {
+      ch = '?';
+    }
+    int g = ch - GLYPH_FIRST;
+    SDL_Rect src = text_atlas.glyphs[g];
+
+    float x0 = pen_x, y0 = y, x1 = pen_x + src.w, y1 = y + src.h;
+    float u0 = src.x * inv_w, v0 = src.y * inv_h;
+    float u1 = (src.x + src.w) * inv_w, v1 = (src.y + src.h) * inv_h;
+    vertices[count++] = (SDL_Vertex){{x0, y0}, color, {u0, v0}};
+    vertices[count++] = (SDL_Vertex){{x1, y0}, color, {u1, v0}};
+    vertices[count++] = (SDL_Vertex){{x0, y1}, color, {u0, v1}};
+    vertices[count++] = (SDL_Vertex){{x1, y1}, color, {u1, v1}};
+
+    pen_x += text_atlas.advance[g];
+  }
+  return count;
+}
+
+// Submit prepared quads in a single call
+void drawTextVertices(SDL_Renderer *renderer, const SDL_Vertex *vertices,
+                      int vertex_count) {
+  // Two triangles per quad, same pattern for every glyph
+  static int indices[MAX_TEXT_LENGTH * 6];
+  static bool indices_ready = false;
+  if (!indices_ready) {
+    for (int q = 0; q < MAX_TEXT_LENGTH; q++) {
+      int base = q * 4;
+      int *tri = &indices[q * 6];
+      tri[0] = base;
+      tri[1] = base + 1;
+      tri[2] = base + 2;
+      tri[3] = base + 2;
+      tri[4] = base + 1;
+      tri[5] = base + 3;
+    }
+    indices_ready = true;
+  }
+
+  if (vertex_count == 0) {
     return;
   }
+  SDL_RenderGeometry(renderer, text_atlas.texture, vertices, vertex_count,
+                     indices, vertex_count / 4 * 6);
+  draw_calls++;
+}
 
-  SDL_Rect text_rect = {10, 10, text_surface->w, text_surface->h};
-  SDL_RenderCopy(renderer, text_texture, NULL, &text_rect);
+// Render the score
+void renderScore(SDL_Renderer *renderer, TTF_Font *font) {
+  // Glyphs are rasterized on first use only
+  if (!text_atlas.texture && !buildGlyphAtlas(renderer, font)) {
+    return;
+  }
+
+  // Lay the string out again only when the score changed
+  static int shown_score = -1;
+  static int vertex_count = 0;
+  static SDL_Vertex vertices[MAX_TEXT_LENGTH * 4];
+  if (shown_score != score) {
+    char score_text[32];
+    sprintf(score_text, "Score: %d", score);
+
+    SDL_Color white = {255, 255, 255, 255};
+    vertex_count = layoutText(score_text, white, 10, 10, vertices);
+    shown_score = score;
+  }
 
-  SDL_FreeSurface(text_surface);
-  SDL_DestroyTexture(text_texture);
+  drawTextVertices(renderer, vertices, vertex_count);
 }
 
 // Render game over message
 void renderGameOver(SDL_Renderer *renderer, TTF_Font *font) {
-  SDL_Color red = {255, 0, 0, 255};
-  SDL_Surface *text_surface = TTF_RenderText_Solid(font, "Game Over", red);
-  if (!text_surface) {
-    printf("Failed to render text: %s\n", TTF_GetError());
+  if (!text_atlas.texture && !buildGlyphAtlas(renderer, font)) {
     return;
   }
 
-  SDL_Texture *text_texture =
-      SDL_CreateTextureFromSurface(renderer, text_surface);
-  if (!text_texture) {
-    printf("Failed to create texture: %s\n", SDL_GetError());
-    SDL_FreeSurface(text_surface);
-    return;
+  // The message never changes, so it is laid out once
+  static int vertex_count = 0;
+  static SDL_Vertex vertices[MAX_TEXT_LENGTH * 4];
+  if (vertex_count == 0) {
+    const char *message = "Game Over";
+    SDL_Color red = {255, 0, 0, 255};
+    int height = text_atlas.glyphs['G' - GLYPH_FIRST].h;
+    vertex_count = layoutText(message, red,
+                              SCREEN_WIDTH / 2 - measureText(message) / 2,
+                              SCREEN_HEIGHT / 2 - height / 2, vertices);
   }
 
-  SDL_Rect text_rect = {SCREEN_WIDTH / 2 - text_surface->w / 2,
-                        SCREEN_HEIGHT / 2 - text_surface->h / 2,
-                        text_surface->w, text_surface->h};
+  drawTextVertices(renderer, vertices, vertex_count);
+}
 
-  SDL_RenderCopy(renderer, text_texture, NULL, &text_rect);
+int main(int argc, char *argv[]) {
+  // Seed random number generator, headless runs reseed from --seed
+  srand(time(NULL));
 
-  SDL_FreeSurface(text_surface);
-  SDL_DestroyTexture(text_texture);
-}
+  // Move benchmark runs without opening a window
+  if (argc > 1 && strcmp(argv[1], "--bench-moves") == 0) {
+    benchmarkMoves();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-render") == 0) {
+    benchmarkRender();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--stress-fill") == 0) {
+    stressFill();
+    return 0;
+  }
+
+  bool headless = false;
+  int headless_games = 100;
+  unsigned int headless_seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--text-stats") == 0) {
+      show_text_stats = true;
+    } else if (strcmp(argv[i], "--draw-stats") == 0) {
+      show_draw_stats = true;
+    } else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+      tick_rate = atoi(argv[++i]);
+      if (tick_rate < 1) {
+        tick_rate = GAME_SPEED;
+      }
+    } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+      target_fps = atoi(argv[++i]);
+      if (target_fps < 0) {
+        target_fps = 0;
+      }
+    } else if (strcmp(argv[i], "--agent") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "bfs") == 0) {
+        controller = &path_controller;
+      } else if (strcmp(argv[i], "keyboard") == 0) {
+        controller = &keyboard_controller;
+      } else {
+        printf("Unknown agent %s, expected bfs or keyboard\n", argv[i]);
+      }
+    } else if (strcmp(argv[i], "--headless") == 0) {
+      headless = true;
+    } else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+      headless_games = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      headless_seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--world") == 0 && i + 1 < argc) {
+      // World size in cells, e.g. 4096x4096
+      int cols, rows;
+      if (sscanf(argv[++i], "%dx%d", &cols, &rows) == 2 && cols >= 4 &&
+          rows >= 4 && (long long)cols * rows <= 1 << 28) {
+        grid_cols = cols;
+        grid_rows = rows;
+      } else {
+        printf("Ignoring --world %s, expected COLSxROWS\n", argv[i]);
+      }
+    }
+  }
+
+  // Simulation only, no window or renderer
+  if (headless) {
+    runHeadless(headless_games, headless_seed);
+    return 0;
+  }
 
-int main() {
   // Initialize SDL
   if (SDL_Init(SDL_INIT_VIDEO) < 0) {
     SDL_Log("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
@@ -400,8 +1374,23 @@ int main() {
   // Game loop variables
   bool quit = false;
   SDL_Event event;
-  Uint32 last_move_time = 0;
-  int move_delay = 1000 / GAME_SPEED;
+  double perf_frequency = (double)SDL_GetPerformanceFrequency();
+  double tick_seconds = 1.0 / tick_rate;
+  double frame_seconds = target_fps > 0 ? 1.0 / target_fps : 0.0;
+  double accumulator = 0.0;
+  Uint64 last_counter = SDL_GetPerformanceCounter();
+  Uint32 stats_time = SDL_GetTicks();
+  int stats_frames = 0;
+  int stats_allocations = text_allocations;
+  int stats_draw_calls = 0;
+
+  // Render target for the cached scene
+  scene_cache =
+      SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                        SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+  if (scene_cache == NULL) {
+    printf("No render target, drawing every frame: %s\n", SDL_GetError());
+  }
 
   // Game loop
   while (!quit) {
@@ -409,6 +1398,10 @@ int main() {
     while (SDL_PollEvent(&event)) {
       if (event.type == SDL_QUIT) {
         quit = true;
+      } else if (event.type == SDL_RENDER_TARGETS_RESET ||
+                 event.type == SDL_RENDER_DEVICE_RESET) {
+        // The cached scene's contents are gone
+        scene_dirty = true;
       } else if (event.type == SDL_KEYDOWN) {
         switch (event.key.keysym.sym) {
         case SDLK_UP:
@@ -435,6 +1428,7 @@ int main() {
           // Reset game on 'R' key press
           if (game_over) {
             initializeGame();
+            scene_dirty = true;
           }
           break;
         case SDLK_ESCAPE:
@@ -444,59 +1438,82 @@ int main() {
       }
     }
 
-    // Get current time
-    Uint32 current_time = SDL_GetTicks();
-
-    // Update game state at regular intervals
-    if (!game_over && current_time - last_move_time >= move_delay) {
-      // Update direction
-      current_direction = next_direction;
-
-      // Update snake position
-      updatePositions();
-
-      // Check for collisions
-      // if (checkCollisionWithWall() || checkCollisionWithSelf()) {
-      //   game_over = true;
-      // }
-
-      if (checkCollisionWithWall()) {
-        game_over = true;
-      }
+    // Measure the frame with the high resolution counter
+    Uint64 frame_start = SDL_GetPerformanceCounter();
+    double elapsed = (frame_start - last_counter) / perf_frequency;
+    last_counter = frame_start;
+    if (elapsed > 0.25) {
+      elapsed = 0.25; // Don't try to catch up after a long stall
+    }
 
-      // Check if snake ate food
-      if (checkCollisionWithFood()) {
-        score++;
-        should_grow = true;
-        generateFood();
+    // Move the snake once for every full tick of banked time
+    if (!game_over) {
+      accumulator += elapsed;
+      while (accumulator >= tick_seconds && !game_over) {
+        updateGame();
+        accumulator -= tick_seconds;
+        scene_dirty = true;
       }
-
-      last_move_time = current_time;
+    } else {
+      accumulator = 0.0;
     }
 
-    // Clear screen
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    // Render game elements
-    renderSnake(renderer);
-    renderFood(renderer);
-    renderScore(renderer, font);
-
-    // Render game over message if game is over
-    if (game_over) {
-      renderGameOver(renderer, font);
+    // Draw the scene again only if a tick changed it, then show the cached
+    // copy. Without render target support it is drawn every frame.
+    if (scene_cache != NULL) {
+      if (scene_dirty) {
+        SDL_SetRenderTarget(renderer, scene_cache);
+        renderScene(renderer, font);
+        SDL_SetRenderTarget(renderer, NULL);
+        scene_dirty = false;
+      }
+      SDL_RenderCopy(renderer, scene_cache, NULL, NULL);
+      draw_calls++;
+    } else {
+      renderScene(renderer, font);
     }
 
     // Update screen
     SDL_RenderPresent(renderer);
+    stats_draw_calls += draw_calls;
+    draw_calls = 0;
+
+    // Report text allocations and draw calls once a second
+    stats_frames++;
+    if ((show_text_stats || show_draw_stats) &&
+        SDL_GetTicks() - stats_time >= 1000) {
+      if (show_text_stats) {
+        printf("text allocations: %d in %d frames (%d total)\n",
+               text_allocations - stats_allocations, stats_frames,
+               text_allocations);
+      }
+      if (show_draw_stats) {
+        printf("draw calls: %.2f per frame over %d frames\n",
+               (double)stats_draw_calls / stats_frames, stats_frames);
+      }
+      stats_time = SDL_GetTicks();
+      stats_frames = 0;
+      stats_allocations = text_allocations;
+      stats_draw_calls = 0;
+    }
 
-    // Cap frame rate
-    SDL_Delay(1000 / 60); // 60 FPS
+    // Sleep off whatever is left of this frame's time budget
+    if (frame_seconds > 0) {
+      double frame_time =
+          (SDL_GetPerformanceCounter() - frame_start) / perf_frequency;
+      int remaining_ms = (int)((frame_seconds - frame_time) * 1000.0);
+      if (remaining_ms > 0) {
+        SDL_Delay(remaining_ms);
+      }
+    }
   }
 
   // Cleanup
+  if (scene_cache != NULL) {
+    SDL_DestroyTexture(scene_cache);
+  }
   cleanupGame();
+  freeGlyphAtlas();
   TTF_CloseFont(font);
   TTF_Quit();
   SDL_DestroyRenderer(renderer);
@@ -3,23 +3,31 @@
 #include <string.h>
 #include <time.h>
 #include <stdbool.h>
+#include <stdarg.h>
 
 // Cross-platform compatibility
 #ifdef _WIN32
 #include <conio.h>
 #include <windows.h>
-#define CLEAR_SCREEN "cls"
+#include <io.h>
+#define NULL_DEVICE "NUL"
+#define STDIN_FILENO 0
+#define STDOUT_FILENO 1
 #else
 #include <termios.h>
 #include <unistd.h>
 #include <fcntl.h>
-#define CLEAR_SCREEN "clear"
+#include <errno.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#define NULL_DEVICE "/dev/null"
 #endif
 
 // Constants
-#define WIDTH 30
-#define HEIGHT 15
-#define QUEUE_SIZE 500
+#define DEFAULT_WIDTH 31  // Maze size unless --size says otherwise. Odd sizes
+#define DEFAULT_HEIGHT 15 // keep a wall all the way round.
+#define QUEUE_INITIAL_CAPACITY 256 // Queues double in size from here
 
 // Game entities
 #define WALL '#'
@@ -29,6 +37,14 @@
 #define VISITED '.'
 #define TREASURE '*'
 
+// How cells are stored: 2 bits each, four to a byte. The exit is a path
+// cell picked out by exit_pos, so it needs no code of its own.
+#define CELL_PATH 0
+#define CELL_WALL 1
+#define CELL_VISITED 2
+#define CELL_TREASURE 3
+#define CELL_BYTES(cells) (((cells) + 3) / 4)
+
 // Key codes
 #define KEY_UP 'w'
 #define KEY_DOWN 's'
@@ -36,6 +52,9 @@
 #define KEY_RIGHT 'd'
 #define KEY_QUIT 'q'
 #define KEY_RESET 'r'
+#define KEY_HINT 'h'
+#define KEY_ESCAPE 27
+#define ESCAPE_TIMEOUT_MS 30 // How long to wait for the rest of an arrow key
 
 // Directions for maze generation
 #define DIR_UP 0
@@ -51,20 +70,110 @@
 #define COLOR_PATH "\033[0m"       // Default
 #define COLOR_VISITED "\033[1;34m" // Bright Blue
 #define COLOR_TREASURE "\033[1;33m" // Bright Yellow
+#define COLOR_HINT "\033[1;35m"     // Bright Magenta
+#define HINT '+'
+
+// Screen layout: the HUD lines above the maze and the status lines below it
+#define HUD_LINES 3
+#define STATUS_LINES 4
 
 // Position structure
 typedef struct {
     int x, y;
 } Position;
 
-// Queue structure for maze generation and pathfinding
+// Queue structure for maze generation and pathfinding. A ring buffer that
+// grows when full, so a search never drops cells however big the maze is.
+// The capacity is always a power of two, so indices wrap with a mask.
 typedef struct {
-    Position items[QUEUE_SIZE];
-    int front, rear;
+    Position *items;
+    size_t capacity;
+    size_t front, count;
 } Queue;
 
+// Shortest paths to the exit, from a breadth-first search over the whole
+// maze. Rather than a distance per cell it keeps the distance mod 3 in two
+// bits: neighbouring cells differ by exactly one step, so the neighbour
+// one step closer to the exit is the one whose layer is one less (mod 3),
+// and following those leads down the shortest path. With the visited and
+// hint bitsets that is 4 bits a cell, 50 MB for a 100M-cell maze.
+typedef struct {
+    unsigned char *visited; // 1 bit per cell, reached by the search
+    unsigned char *layer;   // 2 bits per cell, distance to the exit mod 3
+    unsigned char *hint;    // 1 bit per cell, on the hint path being shown
+    size_t cells;           // Cells the bitsets were allocated for
+    long long reachable;    // Cells with a path to the exit
+    int max_distance;       // Distance of the cell furthest from the exit
+} MazeSolver;
+
+// Colors a screen cell can have, indexes into screen_colors[]
+typedef enum {
+    SCREEN_DEFAULT,
+    SCREEN_PLAYER,
+    SCREEN_WALL,
+    SCREEN_EXIT,
+    SCREEN_VISITED,
+    SCREEN_TREASURE,
+    SCREEN_HINT,
+    SCREEN_COLOR_COUNT
+} ScreenColor;
+
+const char *screen_colors[SCREEN_COLOR_COUNT] = {
+    COLOR_PATH, COLOR_PLAYER, COLOR_WALL, COLOR_EXIT,
+    COLOR_VISITED, COLOR_TREASURE, COLOR_HINT
+};
+
+// One character on the terminal
+typedef struct {
+    char ch;
+    unsigned char color; // ScreenColor
+} ScreenCell;
+
+// Terminal back-end. Frames are drawn into the back buffer; flushing
+// compares it with the front buffer (what the terminal shows) and sends
+// only the cells that changed, with a single write().
+typedef struct {
+    int cols, rows;
+    ScreenCell *front;
+    ScreenCell *back;
+    char *out;               // Escape sequences and text for one frame
+    size_t out_len, out_capacity;
+    int fd;
+    int color;               // Terminal's current color, -1 if unknown
+    int cursor_x, cursor_y;  // Terminal's cursor, -1 if unknown
+    // What the last frame cost, and the totals so far
+    size_t frame_bytes;
+    int frame_writes;
+    unsigned long long total_bytes, total_writes;
+    int frames;
+} Screen;
+
+// Bytes read from the keyboard that haven't been turned into keys yet.
+// Arrow keys arrive as escape sequences that can be split across reads.
+typedef struct {
+    unsigned char bytes[64];
+    int length;
+    double first_time; // When the oldest unhandled byte arrived, 0 if none
+    bool closed;       // Input reached end of file
+} InputBuffer;
+
+// Time from a key arriving to its frame being written
+typedef struct {
+    double last, total, max; // Milliseconds
+    int count;
+} LatencyStats;
+
+// Maze generation algorithms, picked with --algorithm
+typedef enum {
+    MAZE_BACKTRACKER, // Depth-first backtracking with an explicit stack
+    MAZE_ELLER        // Eller's algorithm, row by row in linear time
+} MazeAlgorithm;
+
 // Game state
-char maze[HEIGHT][WIDTH];
+int maze_width = DEFAULT_WIDTH;
+int maze_height = DEFAULT_HEIGHT;
+unsigned char *maze = NULL; // Packed cells, see mazeCode()
+MazeAlgorithm maze_algorithm = MAZE_BACKTRACKER;
 Position player;
 Position exit_pos;
 int treasures_collected = 0;
@@ -72,25 +181,61 @@ int total_treasures = 0;
 int moves = 0;
 int game_time = 0;
 bool game_won = false;
+MazeSolver solver = {0};
+int optimal_moves = 0; // Shortest path from the start to the exit
+bool show_hint = false;
+Screen screen = {0};
+bool show_frame_stats = false;
+InputBuffer input = {{0}, 0, 0, false};
+int input_fd = STDIN_FILENO;
+LatencyStats latency = {0};
 
 // Function prototypes
 void initTerminal();
 void resetTerminal();
-char getch();
-void clearScreen();
+double currentTimeMs();
+bool readInput(int timeout_ms);
+char nextKey(bool flush_partial);
+bool gameStep(int timeout_ms);
+void benchmarkInput();
+void getTerminalSize(int *cols, int *rows);
+bool screenInit(int fd, int cols, int rows);
+void screenShutdown();
+void screenClear();
+void screenPut(int x, int y, char ch, ScreenColor color);
+void screenText(int x, int y, ScreenColor color, const char *format, ...);
+void screenFlush();
+void benchmarkRender();
+bool allocMaze(int width, int height);
+void freeMaze();
+char mazeGet(int x, int y);
+void mazeSet(int x, int y, char cell);
+void reportMazeMemory();
 void initMaze();
+int randomBelow(int n);
+void carveMaze();
+void carveBacktracker();
+void carveEller();
 void generateMaze();
+long long floodFillMaze();
+void benchmarkMaze();
 void placeTreasures(int count);
 void renderMaze();
-void handleInput(char input);
+bool handleInput(char key);
 bool movePlayer(int dx, int dy);
 void resetGame();
 bool isValidPosition(int x, int y);
 void queueInit(Queue *q);
+void queueFree(Queue *q);
 bool queueIsEmpty(Queue *q);
-void queueEnqueue(Queue *q, Position pos);
+bool queueEnqueue(Queue *q, Position pos);
 Position queueDequeue(Queue *q);
-void carvePath(int x, int y);
+bool solveMaze();
+void freeSolver();
+int distanceToExit(Position from);
+void markHintPath(Position from, bool on);
+Position stepTowardExit(Position from);
+void benchmarkSolver();
 
 // Non-Windows terminal setup
 #ifndef _WIN32
@@ -107,58 +252,411 @@ void resetTerminal() {
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_termios);
 }
 
-char getch() {
-    char c;
-    // Set terminal to non-blocking mode
-    int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
-    fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
-    
-    read(STDIN_FILENO, &c, 1);
+double currentTimeMs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+// Wait up to timeout_ms (-1 for as long as it takes) for keyboard input and
+// read everything that is waiting into the input buffer in one go. Returns
+// false if nothing arrived.
+bool readInput(int timeout_ms) {
+    struct pollfd poll_fd = {input_fd, POLLIN, 0};
+    if (input.length == (int)sizeof(input.bytes) || poll(&poll_fd, 1, timeout_ms) <= 0) {
+        return false;
+    }
     
-    // Reset to blocking mode
-    fcntl(STDIN_FILENO, F_SETFL, flags);
-    return c;
+    ssize_t count = read(input_fd, input.bytes + input.length, sizeof(input.bytes) - input.length);
+    if (count <= 0) {
+        input.closed = count == 0;
+        return false;
+    }
+    if (input.length == 0) {
+        input.first_time = currentTimeMs();
+    }
+    input.length += (int)count;
+    return true;
 }
 
 #else
 // Windows terminal setup
 void initTerminal() {
-    // No special setup needed for Windows
+    // Let the console interpret the ANSI escapes the screen sends
+#ifdef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode;
+    if (GetConsoleMode(console, &mode)) {
+        SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+#endif
 }
 
 void resetTerminal() {
     // No special reset needed for Windows
 }
 
-// getch is already defined in conio.h for Windows
+double currentTimeMs() {
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return now.QuadPart * 1000.0 / frequency.QuadPart;
+}
+
+// Wait up to timeout_ms (-1 for as long as it takes) for keyboard input and
+// read everything that is waiting into the input buffer. Returns false if
+// nothing arrived. The console handle also wakes for mouse and focus events,
+// which leave _kbhit() false.
+bool readInput(int timeout_ms) {
+    HANDLE console = GetStdHandle(STD_INPUT_HANDLE);
+    if (WaitForSingleObject(console, timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms) != WAIT_OBJECT_0) {
+        return false;
+    }
+    
+    int start = input.length;
+    while (input.length < (int)sizeof(input.bytes) && _kbhit()) {
+        input.bytes[input.length++] = (unsigned char)_getch();
+    }
+    if (input.length == start) {
+        FlushConsoleInputBuffer(console); // Drop the events that aren't keys
+        return false;
+    }
+    if (start == 0) {
+        input.first_time = currentTimeMs();
+    }
+    return true;
+}
 #endif
 
-// Clear the screen
-void clearScreen() {
-    system(CLEAR_SCREEN);
+// Drop bytes from the front of the input buffer
+static void consumeInput(int count) {
+    input.length -= count;
+    memmove(input.bytes, input.bytes + count, input.length);
 }
 
-// Queue operations
-void queueInit(Queue *q) {
-    q->front = q->rear = -1;
+// Arrow key for the final byte of an escape sequence (Unix) or the second
+// byte of an extended key (Windows), 0 for other keys
+static char arrowKey(unsigned char code) {
+    switch (code) {
+        case 'A': case 72: return KEY_UP;
+        case 'B': case 80: return KEY_DOWN;
+        case 'D': case 75: return KEY_LEFT;
+        case 'C': case 77: return KEY_RIGHT;
+        default: return 0;
+    }
 }
 
-bool queueIsEmpty(Queue *q) {
-    return q->front == -1;
+// Take the next key out of the input buffer, turning arrow keys into the
+// matching WASD key. Returns 0 if there's no complete key, leaving a
+// partial escape sequence in the buffer for more bytes to complete, unless
+// flush_partial says to give up on it.
+char nextKey(bool flush_partial) {
+    while (input.length > 0) {
+        unsigned char first = input.bytes[0];
+        
+        // Windows extended keys: a 0 or 224 prefix and a scan code
+        if (first == 0 || first == 224) {
+            if (input.length < 2) {
+                break;
+            }
+            char key = arrowKey(input.bytes[1]);
+            consumeInput(2);
+            if (key) return key;
+            continue;
+        }
+        
+        if (first != KEY_ESCAPE) {
+            consumeInput(1);
+            return (char)first;
+        }
+        
+        // Escape sequences: ESC [ ... final or ESC O final, the final byte
+        // being in the range @ to ~
+        if (input.length < 2) {
+            break;
+        }
+        if (input.bytes[1] != '[' && input.bytes[1] != 'O') {
+            consumeInput(1); // A lone escape press
+            continue;
+        }
+        int end = 2;
+        while (end < input.length && (input.bytes[end] < '@' || input.bytes[end] > '~')) {
+            end++;
+        }
+        if (end == input.length) {
+            if (input.length == (int)sizeof(input.bytes)) {
+                input.length = 0; // Garbage, not a key
+            }
+            break;
+        }
+        char key = arrowKey(input.bytes[end]);
+        consumeInput(end + 1);
+        if (key) return key;
+    }
+    
+    if (flush_partial) {
+        input.length = 0;
+    }
+    if (input.length == 0) {
+        input.first_time = 0;
+    }
+    return 0;
 }
 
-void queueEnqueue(Queue *q, Position pos) {
-    if ((q->rear + 1) % QUEUE_SIZE == q->front) {
-        // Queue is full
+// Size of the terminal window, 80x24 if it can't be found out
+void getTerminalSize(int *cols, int *rows) {
+    *cols = 80;
+    *rows = 24;
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+        *cols = info.srWindow.Right - info.srWindow.Left + 1;
+        *rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+    }
+#else
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0 && size.ws_row > 0) {
+        *cols = size.ws_col;
+        *rows = size.ws_row;
+    }
+#endif
+}
+
+// Append to the frame's output buffer. It is sized for a full redraw up
+// front, so this never has to grow.
+static void screenAppend(const char *text, size_t length) {
+    if (screen.out_len + length > screen.out_capacity) {
         return;
     }
+    memcpy(screen.out + screen.out_len, text, length);
+    screen.out_len += length;
+}
+
+// Set up the screen buffers for a terminal of the given size, writing to fd.
+// The first flush draws every cell.
+bool screenInit(int fd, int cols, int rows) {
+    size_t cells = (size_t)cols * rows;
+    screen.front = (ScreenCell *)malloc(cells * sizeof(ScreenCell));
+    screen.back = (ScreenCell *)malloc(cells * sizeof(ScreenCell));
+    // Worst case per cell: a cursor move, a color change and the character
+    screen.out_capacity = cells * 24 + 64;
+    screen.out = (char *)malloc(screen.out_capacity);
+    if (screen.front == NULL || screen.back == NULL || screen.out == NULL) {
+        fprintf(stderr, "Failed to allocate the screen buffers\n");
+        screenShutdown();
+        return false;
+    }
+    
+    screen.cols = cols;
+    screen.rows = rows;
+    screen.fd = fd;
+    screen.color = -1;
+    screen.cursor_x = screen.cursor_y = -1;
+    // A character that is never drawn, so every cell differs at first
+    memset(screen.front, 0, cells * sizeof(ScreenCell));
+    screenClear();
+    
+    // Hide the cursor and clear the terminal once
+    screen.out_len = 0;
+    screenAppend("\033[?25l\033[2J", 10);
+    return true;
+}
+
+// Put the terminal back the way it was and free the screen buffers
+void screenShutdown() {
+    if (screen.out != NULL) {
+        char end[32];
+        int length = snprintf(end, sizeof(end), "%s\033[%d;1H\033[?25h\n",
+                              COLOR_RESET, screen.rows);
+        screen.out_len = 0;
+        screenAppend(end, length);
+        screenFlush();
+    }
+    free(screen.front);
+    free(screen.back);
+    free(screen.out);
+    screen.front = screen.back = NULL;
+    screen.out = NULL;
+}
+
+// Blank the back buffer for a new frame
+void screenClear() {
+    size_t cells = (size_t)screen.cols * screen.rows;
+    for (size_t i = 0; i < cells; i++) {
+        screen.back[i].ch = ' ';
+        screen.back[i].color = SCREEN_DEFAULT;
+    }
+}
+
+// Draw one character into the back buffer, clipped to the screen
+void screenPut(int x, int y, char ch, ScreenColor color) {
+    if (x < 0 || x >= screen.cols || y < 0 || y >= screen.rows) {
+        return;
+    }
+    ScreenCell *cell = &screen.back[(size_t)y * screen.cols + x];
+    cell->ch = ch;
+    cell->color = (unsigned char)color;
+}
+
+// Draw printf-style text into the back buffer starting at (x, y)
+void screenText(int x, int y, ScreenColor color, const char *format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
     
-    if (q->front == -1) {
+    for (int i = 0; text[i] != '\0'; i++) {
+        screenPut(x + i, y, text[i], color);
+    }
+}
+
+// Send the cells that changed since the last flush. Changed cells next to
+// each other need no cursor moves and a run of one color needs one color
+// escape. Short gaps of unchanged cells in the current color are rewritten
+// rather than jumped over, as that is shorter than a cursor escape.
+void screenFlush() {
+    for (int y = 0; y < screen.rows; y++) {
+        for (int x = 0; x < screen.cols; x++) {
+            size_t i = (size_t)y * screen.cols + x;
+            ScreenCell cell = screen.back[i];
+            if (cell.ch == screen.front[i].ch && cell.color == screen.front[i].color) {
+                continue;
+            }
+            
+            if (screen.cursor_y != y || screen.cursor_x != x) {
+                int gap = x - screen.cursor_x;
+                bool fill = screen.cursor_y == y && gap > 0 && gap <= 4;
+                for (int g = screen.cursor_x; fill && g < x; g++) {
+                    fill = screen.back[i - x + g].color == screen.color;
+                }
+                if (fill) {
+                    for (int g = screen.cursor_x; g < x; g++) {
+                        screenAppend(&screen.back[i - x + g].ch, 1);
+                    }
+                } else {
+                    char move[24];
+                    int length = snprintf(move, sizeof(move), "\033[%d;%dH", y + 1, x + 1);
+                    screenAppend(move, length);
+                }
+            }
+            if (cell.color != screen.color) {
+                const char *escape = screen_colors[cell.color];
+                screenAppend(escape, strlen(escape));
+                screen.color = cell.color;
+            }
+            screenAppend(&cell.ch, 1);
+            screen.front[i] = cell;
+            screen.cursor_x = x + 1;
+            screen.cursor_y = y;
+        }
+    }
+    
+    // One write for the whole frame, more only if the terminal takes part
+    screen.frame_bytes = screen.out_len;
+    screen.frame_writes = 0;
+    size_t written = 0;
+    while (written < screen.out_len) {
+#ifdef _WIN32
+        int count = _write(screen.fd, screen.out + written, (unsigned int)(screen.out_len - written));
+#else
+        ssize_t count = write(screen.fd, screen.out + written, screen.out_len - written);
+#endif
+        screen.frame_writes++;
+        if (count <= 0) {
+#ifndef _WIN32
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+#endif
+            break;
+        }
+        written += (size_t)count;
+    }
+    screen.out_len = 0;
+    screen.total_bytes += screen.frame_bytes;
+    screen.total_writes += screen.frame_writes;
+    screen.frames++;
+}
+
+// Maze cell access. Everything outside this block goes through these,
+// so the maze can stay packed at 2 bits a cell. Indices are size_t as
+// a 50000x50000 maze has more cells than an int can count.
+static inline size_t mazeIndex(int x, int y) {
+    return (size_t)y * maze_width + x;
+}
+
+static inline unsigned int mazeCode(size_t index) {
+    return (maze[index >> 2] >> ((index & 3) * 2)) & 3;
+}
+
+static inline void mazeSetCode(size_t index, unsigned int code) {
+    unsigned int shift = (index & 3) * 2;
+    maze[index >> 2] = (unsigned char)((maze[index >> 2] & ~(3u << shift)) | (code << shift));
+}
+
+static inline bool mazeIsWall(size_t index) {
+    return mazeCode(index) == CELL_WALL;
+}
+
+// The maze character (WALL, PATH, VISITED, TREASURE or EXIT) at a position
+char mazeGet(int x, int y) {
+    static const char cell_chars[4] = {PATH, WALL, VISITED, TREASURE};
+    if (x == exit_pos.x && y == exit_pos.y) {
+        return EXIT;
+    }
+    return cell_chars[mazeCode(mazeIndex(x, y))];
+}
+
+// Store a maze character. EXIT is stored as a path, exit_pos marks it.
+void mazeSet(int x, int y, char cell) {
+    unsigned int code;
+    switch (cell) {
+        case WALL: code = CELL_WALL; break;
+        case VISITED: code = CELL_VISITED; break;
+        case TREASURE: code = CELL_TREASURE; break;
+        default: code = CELL_PATH; break;
+    }
+    mazeSetCode(mazeIndex(x, y), code);
+}
+
+// Queue operations
+void queueInit(Queue *q) {
+    q->items = NULL;
+    q->capacity = 0;
+    q->front = q->count = 0;
+}
+
+void queueFree(Queue *q) {
+    free(q->items);
+    queueInit(q);
+}
+
+bool queueIsEmpty(Queue *q) {
+    return q->count == 0;
+}
+
+// Returns false only if the queue was full and couldn't grow
+bool queueEnqueue(Queue *q, Position pos) {
+    if (q->count == q->capacity) {
+        // Queue is full, double it and unwrap the items to the front
+        size_t capacity = q->capacity ? q->capacity * 2 : QUEUE_INITIAL_CAPACITY;
+        Position *items = (Position *)malloc(capacity * sizeof(Position));
+        if (items == NULL) {
+            return false;
+        }
+        for (size_t i = 0; i < q->count; i++) {
+            items[i] = q->items[(q->front + i) & (q->capacity - 1)];
+        }
+        free(q->items);
+        q->items = items;
+        q->capacity = capacity;
         q->front = 0;
     }
     
-    q->rear = (q->rear + 1) % QUEUE_SIZE;
-    q->items[q->rear] = pos;
+    q->items[(q->front + q->count) & (q->capacity - 1)] = pos;
+    q->count++;
+    return true;
 }
 
 Position queueDequeue(Queue *q) {
@@ -169,98 +667,499 @@ Position queueDequeue(Queue *q) {
     }
     
     pos = q->items[q->front];
+    q->front = (q->front + 1) & (q->capacity - 1);
+    q->count--;
     
-    if (q->front == q->rear) {
-        // Last element
-        q->front = q->rear = -1;
-    } else {
-        q->front = (q->front + 1) % QUEUE_SIZE;
+    return pos;
+}
+
+// Bit access for the solver's bitsets
+#define BIT_GET(bits, i) (((bits)[(i) >> 3] >> ((i) & 7)) & 1)
+#define BIT_SET(bits, i) ((bits)[(i) >> 3] |= (unsigned char)(1 << ((i) & 7)))
+#define BIT_CLEAR(bits, i) ((bits)[(i) >> 3] &= (unsigned char)~(1 << ((i) & 7)))
+#define LAYER_GET(bits, i) (((bits)[(i) >> 2] >> (((i) & 3) * 2)) & 3)
+#define LAYER_SET(bits, i, v) \
+    ((bits)[(i) >> 2] |= (unsigned char)((v) << (((i) & 3) * 2)))
+
+// Breadth-first search from the exit over the whole maze, filling in the
+// solver's distance layers and working out the optimal move count from the
+// player's position. Returns false if memory ran out.
+bool solveMaze() {
+    size_t cells = (size_t)maze_width * maze_height;
+    if (solver.cells != cells) {
+        freeSolver();
+        solver.visited = (unsigned char *)malloc(cells / 8 + 1);
+        solver.layer = (unsigned char *)malloc(cells / 4 + 1);
+        solver.hint = (unsigned char *)malloc(cells / 8 + 1);
+        if (solver.visited == NULL || solver.layer == NULL || solver.hint == NULL) {
+            fprintf(stderr, "Failed to allocate the maze solver\n");
+            freeSolver();
+            return false;
+        }
+        solver.cells = cells;
     }
+    memset(solver.visited, 0, cells / 8 + 1);
+    memset(solver.layer, 0, cells / 4 + 1);
+    memset(solver.hint, 0, cells / 8 + 1);
+    solver.reachable = 0;
+    solver.max_distance = 0;
+    optimal_moves = -1;
     
-    return pos;
+    // Directions: up, right, down, left
+    int dx[] = {0, 1, 0, -1};
+    int dy[] = {-1, 0, 1, 0};
+    
+    Queue queue;
+    queueInit(&queue);
+    size_t start = mazeIndex(exit_pos.x, exit_pos.y);
+    BIT_SET(solver.visited, start);
+    bool ok = queueEnqueue(&queue, exit_pos);
+    
+    // Count down the cells left at the current distance to know when the
+    // next distance starts
+    int distance = 0;
+    size_t left_at_distance = 1, next_distance = 0;
+    
+    while (ok && !queueIsEmpty(&queue)) {
+        Position pos = queueDequeue(&queue);
+        solver.reachable++;
+        if (pos.x == player.x && pos.y == player.y) {
+            optimal_moves = distance;
+        }
+        
+        unsigned int layer = (distance + 1) % 3;
+        for (int dir = 0; dir < 4; dir++) {
+            // The maze has a wall all the way round, so a path cell's
+            // neighbours are always inside it
+            Position next = {pos.x + dx[dir], pos.y + dy[dir]};
+            size_t next_index = mazeIndex(next.x, next.y);
+            if (mazeIsWall(next_index) || BIT_GET(solver.visited, next_index)) {
+                continue;
+            }
+            BIT_SET(solver.visited, next_index);
+            LAYER_SET(solver.layer, next_index, layer);
+            if (!queueEnqueue(&queue, next)) {
+                ok = false;
+                break;
+            }
+            next_distance++;
+        }
+        
+        if (--left_at_distance == 0 && next_distance > 0) {
+            distance++;
+            left_at_distance = next_distance;
+            next_distance = 0;
+        }
+    }
+    solver.max_distance = distance;
+    
+    queueFree(&queue);
+    if (!ok) {
+        fprintf(stderr, "Ran out of memory solving the maze\n");
+    }
+    return ok;
 }
 
-// Initialize the maze with walls
-void initMaze() {
-    // Fill maze with walls
-    for (int y = 0; y < HEIGHT; y++) {
-        for (int x = 0; x < WIDTH; x++) {
-            maze[y][x] = WALL;
+void freeSolver() {
+    free(solver.visited);
+    free(solver.layer);
+    free(solver.hint);
+    memset(&solver, 0, sizeof(solver));
+}
+
+// The neighbour one step closer to the exit, or the cell itself if it is
+// the exit or can't reach it
+Position stepTowardExit(Position from) {
+    int dx[] = {0, 1, 0, -1};
+    int dy[] = {-1, 0, 1, 0};
+    size_t index = mazeIndex(from.x, from.y);
+    
+    if (!BIT_GET(solver.visited, index) ||
+        (from.x == exit_pos.x && from.y == exit_pos.y)) {
+        return from;
+    }
+    unsigned int closer = (LAYER_GET(solver.layer, index) + 2) % 3;
+    for (int dir = 0; dir < 4; dir++) {
+        Position next = {from.x + dx[dir], from.y + dy[dir]};
+        size_t next_index = mazeIndex(next.x, next.y);
+        if (!mazeIsWall(next_index) && BIT_GET(solver.visited, next_index) &&
+            LAYER_GET(solver.layer, next_index) == closer) {
+            return next;
+        }
+    }
+    return from;
+}
+
+// Moves needed to reach the exit from a cell, -1 if it can't be reached.
+// Walks the shortest path, so it costs the length of the answer.
+int distanceToExit(Position from) {
+    if (!BIT_GET(solver.visited, mazeIndex(from.x, from.y))) {
+        return -1;
+    }
+    int distance = 0;
+    while (from.x != exit_pos.x || from.y != exit_pos.y) {
+        from = stepTowardExit(from);
+        distance++;
+    }
+    return distance;
+}
+
+// Mark (or unmark) the shortest path from a cell to the exit as the hint
+void markHintPath(Position from, bool on) {
+    if (!BIT_GET(solver.visited, mazeIndex(from.x, from.y))) {
+        return;
+    }
+    while (true) {
+        size_t index = mazeIndex(from.x, from.y);
+        if (on) {
+            BIT_SET(solver.hint, index);
+        } else {
+            BIT_CLEAR(solver.hint, index);
         }
+        if (from.x == exit_pos.x && from.y == exit_pos.y) {
+            break;
+        }
+        from = stepTowardExit(from);
     }
 }
 
+// Allocate the maze for the given size, replacing the old one
+bool allocMaze(int width, int height) {
+    unsigned char *cells = (unsigned char *)malloc(CELL_BYTES((size_t)width * height));
+    if (cells == NULL) {
+        fprintf(stderr, "Failed to allocate a %dx%d maze\n", width, height);
+        return false;
+    }
+    freeMaze();
+    maze = cells;
+    maze_width = width;
+    maze_height = height;
+    return true;
+}
+
+// Release the maze
+void freeMaze() {
+    free(maze);
+    maze = NULL;
+}
+
+// Initialize the maze with walls
+void initMaze() {
+    // Fill maze with walls, CELL_WALL in all four slots of each byte
+    memset(maze, 0x55, CELL_BYTES((size_t)maze_width * maze_height));
+}
+
 // Check if a position is valid (within bounds)
 bool isValidPosition(int x, int y) {
-    return x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT;
+    return x >= 0 && x < maze_width && y >= 0 && y < maze_height;
 }
 
-// Recursive backtracking maze generation
-void carvePath(int x, int y) {
-    // Mark current cell as path
-    maze[y][x] = PATH;
-    
+// Random number in 0..n-1. Two rand() calls are combined where RAND_MAX is
+// as small as 32767, so every cell of a large maze can come up.
+int randomBelow(int n) {
+    unsigned int r = rand();
+    if (RAND_MAX < n) {
+        r = r * ((unsigned int)RAND_MAX + 1) + rand();
+    }
+    return r % n;
+}
+
+// Generator random numbers (xorshift32). Carving draws one or two numbers
+// per cell, which adds up on huge mazes, so it doesn't go through rand().
+// Seeded from rand() so --seed still decides the maze.
+static unsigned int carve_random = 1;
+
+static inline unsigned int carveRandom() {
+    unsigned int x = carve_random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return carve_random = x;
+}
+
+// Carve a perfect maze into the walls. Maze cells sit at odd coordinates,
+// (cx, cy) in cell terms is (2cx + 1, 2cy + 1) in the maze, and the walls
+// between them are knocked out to join cells.
+void carveMaze() {
+    carve_random = ((unsigned int)rand() << 16) ^ (unsigned int)rand();
+    if (carve_random == 0) carve_random = 1;
+
+    if (maze_algorithm == MAZE_ELLER) {
+        carveEller();
+    } else {
+        carveBacktracker();
+    }
+}
+
+// Depth-first backtracking, as the old recursive carvePath() did but with
+// the path kept on an explicit stack, so the maze size isn't limited by the
+// call stack. The stack holds the direction each cell was entered from,
+// packed at 2 bits like the maze, so it can never outgrow a quarter of it.
+void carveBacktracker() {
+    int cols = (maze_width - 1) / 2;
+    int rows = (maze_height - 1) / 2;
+    if (cols < 1 || rows < 1) return;
+
+    unsigned char *stack = (unsigned char *)malloc(CELL_BYTES((size_t)cols * rows));
+    if (stack == NULL) {
+        fprintf(stderr, "Failed to allocate the maze carving stack\n");
+        return;
+    }
+    size_t depth = 0;
+
     // Directions: up, right, down, left
     int dx[] = {0, 1, 0, -1};
     int dy[] = {-1, 0, 1, 0};
-    
-    // Shuffle directions
-    int dirs[4] = {0, 1, 2, 3};
-    for (int i = 0; i < 4; i++) {
-        int j = rand() % 4;
-        int temp = dirs[i];
-        dirs[i] = dirs[j];
-        dirs[j] = temp;
-    }
-    
-    // Try each direction
-    for (int i = 0; i < 4; i++) {
-        int dir = dirs[i];
-        int nx = x + dx[dir] * 2; // Move two cells in this direction
-        int ny = y + dy[dir] * 2;
-        
-        if (isValidPosition(nx, ny) && maze[ny][nx] == WALL) {
+
+    // Start carving from a random cell
+    int x = 1 + 2 * randomBelow(cols);
+    int y = 1 + 2 * randomBelow(rows);
+    mazeSetCode(mazeIndex(x, y), CELL_PATH);
+
+    while (true) {
+        // Pick a random direction leading to an uncarved cell
+        int options[4], option_count = 0;
+        for (int dir = 0; dir < 4; dir++) {
+            int nx = x + dx[dir] * 2; // Move two cells in this direction
+            int ny = y + dy[dir] * 2;
+            if (nx > 0 && nx < maze_width - 1 && ny > 0 &&
+                ny < maze_height - 1 &&
+                mazeIsWall(mazeIndex(nx, ny))) {
+                options[option_count++] = dir;
+            }
+        }
+
+        if (option_count > 0) {
+            int dir = options[carveRandom() % option_count];
             // Carve through the wall between current cell and next cell
-            maze[y + dy[dir]][x + dx[dir]] = PATH;
-            // Recursively carve from the next cell
-            carvePath(nx, ny);
+            mazeSetCode(mazeIndex(x + dx[dir], y + dy[dir]), CELL_PATH);
+            x += dx[dir] * 2;
+            y += dy[dir] * 2;
+            mazeSetCode(mazeIndex(x, y), CELL_PATH);
+            unsigned int shift = (depth & 3) * 2;
+            stack[depth >> 2] = (unsigned char)((stack[depth >> 2] & ~(3u << shift)) | (dir << shift));
+            depth++;
+        } else if (depth > 0) {
+            // Dead end, step back the way we came
+            depth--;
+            int dir = (stack[depth >> 2] >> ((depth & 3) * 2)) & 3;
+            x -= dx[dir] * 2;
+            y -= dy[dir] * 2;
+        } else {
+            break; // Back at the start with nothing left to carve
+        }
+    }
+
+    free(stack);
+}
+
+// Eller's algorithm: carve one row of cells at a time, tracking which cells
+// of the current row are already connected. Each set is a circular list
+// through left[]/right[] in left to right order, which makes "is the next
+// cell in my set" a single comparison and joining two sets O(1). Linear
+// time, and the extra memory is two ints per column.
+void carveEller() {
+    int cols = (maze_width - 1) / 2;
+    int rows = (maze_height - 1) / 2;
+    if (cols < 1 || rows < 1) return;
+
+    int *left = (int *)malloc(cols * sizeof(int));
+    int *right = (int *)malloc(cols * sizeof(int));
+    if (left == NULL || right == NULL) {
+        fprintf(stderr, "Failed to allocate the maze carving rows\n");
+        free(left);
+        free(right);
+        return;
+    }
+
+    // Every cell of the first row starts in a set of its own
+    for (int c = 0; c < cols; c++) {
+        left[c] = right[c] = c;
+    }
+
+    for (int r = 0; r < rows; r++) {
+        size_t row = mazeIndex(0, 2 * r + 1);
+        bool last_row = (r == rows - 1);
+
+        for (int c = 0; c < cols; c++) {
+            mazeSetCode(row + 2 * c + 1, CELL_PATH);
+
+            // Join with the cell to the right if it is in another set. The
+            // last row joins everything so the maze ends up connected.
+            if (c + 1 < cols && c + 1 != right[c] &&
+                (last_row || (carveRandom() & 1))) {
+                right[left[c + 1]] = right[c];
+                left[right[c]] = left[c + 1];
+                right[c] = c + 1;
+                left[c + 1] = c;
+                mazeSetCode(row + 2 * c + 2, CELL_PATH);
+            }
+            if (last_row) {
+                continue;
+            }
+
+            // Every set has to continue into the next row somewhere, so a
+            // cell may only keep its floor if others in its set are left
+            if (c != right[c] && (carveRandom() & 1)) {
+                right[left[c]] = right[c];
+                left[right[c]] = left[c];
+                left[c] = right[c] = c;
+            } else {
+                mazeSetCode(row + maze_width + 2 * c + 1, CELL_PATH);
+            }
         }
     }
+
+    free(left);
+    free(right);
 }
 
 // Generate a random maze
 void generateMaze() {
+    exit_pos.x = exit_pos.y = -1;
     initMaze();
-    
-    // Start carving from a random position (must be odd coordinates)
-    int start_x = 1 + 2 * (rand() % ((WIDTH - 1) / 2));
-    int start_y = 1 + 2 * (rand() % ((HEIGHT - 1) / 2));
-    
-    // Ensure start coordinates are within bounds
-    if (start_x >= WIDTH) start_x = WIDTH - 2;
-    if (start_y >= HEIGHT) start_y = HEIGHT - 2;
-    
-    // Start carving
-    carvePath(start_x, start_y);
+    carveMaze();
     
     // Set player position at a random path position
     do {
-        player.x = rand() % (WIDTH - 2) + 1;
-        player.y = rand() % (HEIGHT - 2) + 1;
-    } while (maze[player.y][player.x] != PATH);
+        player.x = randomBelow(maze_width - 2) + 1;
+        player.y = randomBelow(maze_height - 2) + 1;
+    } while (mazeGet(player.x, player.y) != PATH);
     
-    // Set exit position at a random path position far from player
+    // Set exit position at a random path position far from player. The
+    // exit itself is marked by exit_pos, so it is placed once this is set.
+    Position exit_cell;
     do {
-        exit_pos.x = rand() % (WIDTH - 2) + 1;
-        exit_pos.y = rand() % (HEIGHT - 2) + 1;
-        // Ensure exit is far enough from player
-        int dx = abs(exit_pos.x - player.x);
-        int dy = abs(exit_pos.y - player.y);
-    } while (maze[exit_pos.y][exit_pos.x] != PATH || 
-             (abs(exit_pos.x - player.x) + abs(exit_pos.y - player.y)) < (WIDTH + HEIGHT) / 3);
+        exit_cell.x = randomBelow(maze_width - 2) + 1;
+        exit_cell.y = randomBelow(maze_height - 2) + 1;
+    } while (mazeGet(exit_cell.x, exit_cell.y) != PATH || 
+             (abs(exit_cell.x - player.x) + abs(exit_cell.y - player.y)) < (maze_width + maze_height) / 3);
+    exit_pos = exit_cell;
+}
+
+// Flood fill the path cells reachable from (1, 1), marking them visited,
+// and return how many there were; -1 if the queue couldn't grow.
+long long floodFillMaze() {
+    static const int dx[4] = {0, 1, 0, -1};
+    static const int dy[4] = {-1, 0, 1, 0};
+    Queue queue;
+    queueInit(&queue);
+    Position start = {1, 1};
+    long long reached = 0;
+
+    if (mazeCode(mazeIndex(start.x, start.y)) != CELL_PATH) {
+        return 0;
+    }
+    mazeSetCode(mazeIndex(start.x, start.y), CELL_VISITED);
+    if (!queueEnqueue(&queue, start)) {
+        return -1;
+    }
+    while (!queueIsEmpty(&queue)) {
+        Position pos = queueDequeue(&queue);
+        reached++;
+        for (int d = 0; d < 4; d++) {
+            Position next = {pos.x + dx[d], pos.y + dy[d]};
+            if (next.x < 0 || next.x >= maze_width || next.y < 0 || next.y >= maze_height) {
+                continue;
+            }
+            size_t index = mazeIndex(next.x, next.y);
+            if (mazeCode(index) != CELL_PATH) {
+                continue;
+            }
+            mazeSetCode(index, CELL_VISITED);
+            if (!queueEnqueue(&queue, next)) {
+                queueFree(&queue);
+                return -1;
+            }
+        }
+    }
+    queueFree(&queue);
+    return reached;
+}
+
+// Time each generator on the current maze size (10000x10000 unless --size
+// is given) and check the result is a perfect maze: n cells joined by
+// n - 1 passages, all reachable by a flood fill from the first cell. A
+// connected graph with one edge fewer than its nodes has no loops.
+void benchmarkMaze() {
+    const char *names[] = {"backtracker", "eller"};
+    long long cols = (maze_width - 1) / 2, rows = (maze_height - 1) / 2;
+    long long expected_paths = 2 * cols * rows - 1;
+    double cells = (double)maze_width * maze_height;
+
+    printf("maze %dx%d (%lld x %lld cells), %.0f MB\n", maze_width,
+           maze_height, cols, rows, CELL_BYTES(cells) / (1024.0 * 1024.0));
+    printf("%-12s %10s %16s %8s\n", "algorithm", "seconds", "cells/s",
+           "perfect");
+    for (int a = 0; a < 2; a++) {
+        maze_algorithm = (MazeAlgorithm)a;
+        initMaze();
+        clock_t start = clock();
+        carveMaze();
+        double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        long long paths = 0;
+        for (size_t i = 0; i < (size_t)maze_width * maze_height; i++) {
+            paths += mazeCode(i) == CELL_PATH;
+        }
+        bool connected = floodFillMaze() == paths;
+        printf("%-12s %10.3f %16.0f %8s\n", names[a], seconds,
+               seconds > 0 ? cells / seconds : 0.0,
+               connected && paths == expected_paths ? "yes" : "NO");
+    }
+}
+
+// Memory the maze needs at the current size (50001x50001 unless --size is
+// given), next to the byte-per-cell layout it used to have, then carve one
+// to show it fits.
+void reportMazeMemory() {
+    const char *names[] = {"backtracker", "eller"};
+    double mb = 1024.0 * 1024.0;
+    size_t cells = (size_t)maze_width * maze_height;
+    size_t maze_cells = (size_t)((maze_width - 1) / 2) * ((maze_height - 1) / 2);
+    size_t stack_bytes = maze_algorithm == MAZE_BACKTRACKER ? CELL_BYTES(maze_cells)
+                                                            : 2 * sizeof(int) * ((maze_width - 1) / 2);
+    
+    printf("maze %dx%d, %zu cells\n", maze_width, maze_height, cells);
+    printf("packed maze       %10.1f MB (2 bits a cell)\n", CELL_BYTES(cells) / mb);
+    printf("byte per cell     %10.1f MB (old layout)\n", cells / mb);
+    printf("%-17s %10.1f MB while carving\n", names[maze_algorithm], stack_bytes / mb);
+    printf("solver            %10.1f MB (4 bits a cell)\n", (cells / 2.0) / mb);
+    
+    initMaze();
+    clock_t start = clock();
+    carveMaze();
+    printf("carved in %.1f s\n", (double)(clock() - start) / CLOCKS_PER_SEC);
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        printf("peak resident     %10.1f MB\n", usage.ru_maxrss / 1024.0);
+    }
+#endif
+}
+
+// Time the solver on a freshly generated maze of the current size
+// (10001x10001, about 100M cells, unless --size is given) and check the
+// optimal move count against a walk down the shortest path.
+void benchmarkSolver() {
+    double cells = (double)maze_width * maze_height;
     
-    // Place the exit
-    maze[exit_pos.y][exit_pos.x] = EXIT;
+    generateMaze();
+    clock_t start = clock();
+    if (!solveMaze()) {
+        return;
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    
+    size_t solver_bytes = 2 * (solver.cells / 8 + 1) + solver.cells / 4 + 1;
+    int walked = distanceToExit(player);
+    printf("maze %dx%d, %.0f MB; solver %.1f MB\n", maze_width, maze_height,
+           CELL_BYTES(cells) / (1024.0 * 1024.0), solver_bytes / (1024.0 * 1024.0));
+    printf("solve %.3f s, %.0f cells/s, %lld reachable cells\n", seconds,
+           seconds > 0 ? cells / seconds : 0.0, solver.reachable);
+    printf("optimal moves %d, path walked %d (%s), furthest cell %d\n",
+           optimal_moves, walked, walked == optimal_moves ? "ok" : "MISMATCH",
+           solver.max_distance);
 }
 
 // Place treasures in the maze
@@ -271,88 +1170,239 @@ void placeTreasures(int count) {
     for (int i = 0; i < count; i++) {
         int x, y;
         do {
-            x = rand() % (WIDTH - 2) + 1;
-            y = rand() % (HEIGHT - 2) + 1;
-        } while (maze[y][x] != PATH || 
-                 (x == player.x && y == player.y) || 
-                 (x == exit_pos.x && y == exit_pos.y));
+            x = randomBelow(maze_width - 2) + 1;
+            y = randomBelow(maze_height - 2) + 1;
+        } while (mazeGet(x, y) != PATH || 
+                 (x == player.x && y == player.y));
         
-        maze[y][x] = TREASURE;
+        mazeSet(x, y, TREASURE);
     }
 }
 
-// Render the maze
+// Screen color for a maze character
+static ScreenColor mazeColor(char cell) {
+    switch (cell) {
+        case WALL: return SCREEN_WALL;
+        case EXIT: return SCREEN_EXIT;
+        case VISITED: return SCREEN_VISITED;
+        case TREASURE: return SCREEN_TREASURE;
+        default: return SCREEN_DEFAULT;
+    }
+}
+
+// Render the maze. Mazes bigger than the terminal show the part around
+// the player, which only scrolls once the player gets near its edge so a
+// step doesn't redraw the whole view.
 void renderMaze() {
-    clearScreen();
+    static int left = 0, top = 0;
+
+    screenClear();
     
     // Display game info
-    printf("Terminal Maze Explorer | Moves: %d | Treasures: %d/%d\n", 
-           moves, treasures_collected, total_treasures);
-    printf("Controls: WASD = Move, Q = Quit, R = Reset\n\n");
+    screenText(0, 0, SCREEN_DEFAULT, "Terminal Maze Explorer | Moves: %d | Optimal: %d | Treasures: %d/%d",
+               moves, optimal_moves, treasures_collected, total_treasures);
+    screenText(0, 1, SCREEN_DEFAULT, "Controls: WASD = Move, H = Hint, Q = Quit, R = Reset");
+    if (show_frame_stats) {
+        screenText(0, 2, SCREEN_DEFAULT, "Last frame: %zu bytes, %d write(s) | Average: %.0f bytes | Latency: %.3f ms",
+                   screen.frame_bytes, screen.frame_writes,
+                   screen.frames ? (double)screen.total_bytes / screen.frames : 0.0, latency.last);
+    }
+    
+    // Work out which part of the maze fits
+    int view_cols = screen.cols < maze_width ? screen.cols : maze_width;
+    int view_rows = screen.rows - HUD_LINES - STATUS_LINES;
+    if (view_rows < 1) view_rows = 1;
+    if (view_rows > maze_height) view_rows = maze_height;
+    int margin_x = view_cols / 4, margin_y = view_rows / 4;
+    if (player.x < left + margin_x || player.x >= left + view_cols - margin_x) {
+        left = player.x - view_cols / 2;
+    }
+    if (player.y < top + margin_y || player.y >= top + view_rows - margin_y) {
+        top = player.y - view_rows / 2;
+    }
+    if (left > maze_width - view_cols) left = maze_width - view_cols;
+    if (top > maze_height - view_rows) top = maze_height - view_rows;
+    if (left < 0) left = 0;
+    if (top < 0) top = 0;
     
     // Draw the maze
-    for (int y = 0; y < HEIGHT; y++) {
-        for (int x = 0; x < WIDTH; x++) {
+    for (int row = 0; row < view_rows; row++) {
+        int y = top + row;
+        for (int col = 0; col < view_cols; col++) {
+            int x = left + col;
+            char cell = mazeGet(x, y);
             // Check if this is the player's position
             if (x == player.x && y == player.y) {
-                printf("%sP%s", COLOR_PLAYER, COLOR_RESET);
+                screenPut(col, HUD_LINES + row, PLAYER, SCREEN_PLAYER);
+            } else if (show_hint && cell != EXIT &&
+                       BIT_GET(solver.hint, mazeIndex(x, y))) {
+                screenPut(col, HUD_LINES + row, HINT, SCREEN_HINT);
             } else {
                 // Otherwise draw the maze element with appropriate color
-                switch (maze[y][x]) {
-                    case WALL:
-                        printf("%s%c%s", COLOR_WALL, WALL, COLOR_RESET);
-                        break;
-                    case EXIT:
-                        printf("%s%c%s", COLOR_EXIT, EXIT, COLOR_RESET);
-                        break;
-                    case VISITED:
-                        printf("%s%c%s", COLOR_VISITED, VISITED, COLOR_RESET);
-                        break;
-                    case TREASURE:
-                        printf("%s%c%s", COLOR_TREASURE, TREASURE, COLOR_RESET);
-                        break;
-                    default:
-                        printf("%s%c%s", COLOR_PATH, maze[y][x], COLOR_RESET);
-                }
+                screenPut(col, HUD_LINES + row, cell, mazeColor(cell));
             }
         }
-        printf("\n");
     }
     
     // Display game status
     if (game_won) {
-        printf("\nCongratulations! You found the exit!\n");
-        printf("Final Score: %d (Lower is better)\n", moves);
-        printf("Press 'R' to play again or 'Q' to quit\n");
+        int y = HUD_LINES + view_rows + 1;
+        screenText(0, y, SCREEN_DEFAULT, "Congratulations! You found the exit!");
+        screenText(0, y + 1, SCREEN_DEFAULT, "Final Score: %d (Lower is better, best possible was %d)", moves, optimal_moves);
+        screenText(0, y + 2, SCREEN_DEFAULT, "Press 'R' to play again or 'Q' to quit");
     }
+    
+    screenFlush();
 }
 
-// Handle player input
-void handleInput(char input) {
+// Measure what frames cost on an 80x24 screen written to the null device:
+// the first full frame, a frame with nothing changed, and a frame after the
+// player moves one cell. For comparison, the old renderer cleared the
+// screen through a shell and printed every cell with two color escapes.
+void benchmarkRender() {
+    FILE *null_device = fopen(NULL_DEVICE, "w");
+    if (null_device == NULL || !screenInit(fileno(null_device), 80, 24)) {
+        fprintf(stderr, "Failed to set up the render benchmark\n");
+        if (null_device != NULL) fclose(null_device);
+        return;
+    }
+    
+    resetGame();
+    renderMaze();
+    printf("first frame:     %6zu bytes, %d write(s)\n", screen.frame_bytes, screen.frame_writes);
+    renderMaze();
+    printf("unchanged frame: %6zu bytes, %d write(s)\n", screen.frame_bytes, screen.frame_writes);
+    
+    int dx[] = {0, 1, 0, -1};
+    int dy[] = {-1, 0, 1, 0};
+    for (int dir = 0; dir < 4 && !movePlayer(dx[dir], dy[dir]); dir++) {
+    }
+    renderMaze();
+    printf("one-cell move:   %6zu bytes, %d write(s)\n", screen.frame_bytes, screen.frame_writes);
+    
+    // Bytes the old printf renderer sent for every frame of this maze,
+    // not counting the clear
+    size_t old_bytes = 0;
+    for (int y = 0; y < maze_height; y++) {
+        for (int x = 0; x < maze_width; x++) {
+            char cell = mazeGet(x, y);
+            ScreenColor color = (x == player.x && y == player.y) ? SCREEN_PLAYER : mazeColor(cell);
+            old_bytes += strlen(screen_colors[color]) + 1 + strlen(COLOR_RESET);
+        }
+        old_bytes++;
+    }
+    printf("old renderer:    %6zu bytes for the maze, plus a shell for the clear\n", old_bytes);
+    
+    screenShutdown();
+    fclose(null_device);
+}
+
+// Handle player input, returning whether anything on screen changed
+bool handleInput(char key) {
     if (game_won) {
-        if (input == KEY_RESET) {
+        if (key == KEY_RESET) {
             resetGame();
+            return true;
         }
-        return;
+        return false;
     }
     
-    switch (input) {
+    switch (key) {
         case KEY_UP:
-            movePlayer(0, -1);
-            break;
+            return movePlayer(0, -1);
         case KEY_DOWN:
-            movePlayer(0, 1);
-            break;
+            return movePlayer(0, 1);
         case KEY_LEFT:
-            movePlayer(-1, 0);
-            break;
+            return movePlayer(-1, 0);
         case KEY_RIGHT:
-            movePlayer(1, 0);
-            break;
+            return movePlayer(1, 0);
         case KEY_RESET:
             resetGame();
+            return true;
+        case KEY_HINT:
+            // Show or hide the shortest way to the exit
+            show_hint = !show_hint;
+            markHintPath(player, show_hint);
+            return true;
+    }
+    return false;
+}
+
+// One round of the game loop: wait up to timeout_ms for keys, handle all
+// of them, and redraw once if anything changed. Nothing runs between keys,
+// so an idle game sleeps in readInput(). Returns false when the player quits.
+bool gameStep(int timeout_ms) {
+    // A partial escape sequence gets a moment for the rest to arrive,
+    // after which it was a lone escape press
+    bool partial = input.length > 0;
+    if (!readInput(partial ? ESCAPE_TIMEOUT_MS : timeout_ms) && partial) {
+        nextKey(true);
+    }
+    if (input.closed) {
+        return false;
+    }
+    
+    double arrived = input.first_time;
+    bool changed = false;
+    char key;
+    while ((key = nextKey(false)) != 0) {
+        if (key == KEY_QUIT) {
+            return false;
+        }
+        changed |= handleInput(key);
+    }
+    
+    if (changed) {
+        renderMaze();
+        latency.last = currentTimeMs() - arrived;
+        latency.total += latency.last;
+        if (latency.last > latency.max) latency.max = latency.last;
+        latency.count++;
+    }
+    return true;
+}
+
+// Feed moves to the game loop through a pipe, with the screen going to the
+// null device, and time each from the key arriving to its frame written.
+// The moves follow the shortest path so every key changes the screen.
+void benchmarkInput() {
+#ifdef _WIN32
+    printf("--bench-input needs pipes and poll(), it isn't available on Windows\n");
+#else
+    int pipe_fds[2];
+    FILE *null_device = fopen(NULL_DEVICE, "w");
+    if (null_device == NULL || pipe(pipe_fds) != 0 ||
+        !screenInit(fileno(null_device), 80, 24)) {
+        fprintf(stderr, "Failed to set up the input benchmark\n");
+        if (null_device != NULL) fclose(null_device);
+        return;
+    }
+    input_fd = pipe_fds[0];
+    
+    resetGame();
+    renderMaze();
+    const int keys = 10000;
+    for (int i = 0; i < keys; i++) {
+        char key = KEY_RESET;
+        if (!game_won) {
+            Position next = stepTowardExit(player);
+            key = next.x > player.x ? KEY_RIGHT : next.x < player.x ? KEY_LEFT :
+                  next.y > player.y ? KEY_DOWN : KEY_UP;
+        }
+        if (write(pipe_fds[1], &key, 1) != 1 || !gameStep(-1)) {
             break;
+        }
     }
+    printf("%d keys, latency avg %.3f ms, max %.3f ms, %.0f bytes per frame\n",
+           latency.count, latency.count ? latency.total / latency.count : 0.0,
+           latency.max, screen.frames ? (double)screen.total_bytes / screen.frames : 0.0);
+    
+    screenShutdown();
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    fclose(null_device);
+    input_fd = STDIN_FILENO;
+#endif
 }
 
 // Move the player
@@ -361,30 +1411,37 @@ bool movePlayer(int dx, int dy) {
     int new_y = player.y + dy;
     
     // Check if the new position is valid
-    if (!isValidPosition(new_x, new_y) || maze[new_y][new_x] == WALL) {
+    char cell = isValidPosition(new_x, new_y) ? mazeGet(new_x, new_y) : WALL;
+    if (cell == WALL) {
         return false;
     }
     
     moves++;
     
     // Check if the player reached the exit
-    if (maze[new_y][new_x] == EXIT) {
+    if (cell == EXIT) {
         game_won = true;
     }
     
     // Check if the player found a treasure
-    if (maze[new_y][new_x] == TREASURE) {
+    if (cell == TREASURE) {
         treasures_collected++;
     }
     
     // Mark the current position as visited
-    if (maze[player.y][player.x] != EXIT) {
-        maze[player.y][player.x] = VISITED;
+    if (mazeGet(player.x, player.y) != EXIT) {
+        mazeSet(player.x, player.y, VISITED);
     }
     
-    // Update player position
+    // Update player position, moving the hint along with it
+    if (show_hint) {
+        markHintPath(player, false);
+    }
     player.x = new_x;
     player.y = new_y;
+    if (show_hint) {
+        markHintPath(player, true);
+    }
     
     return true;
 }
@@ -393,87 +1450,127 @@ bool movePlayer(int dx, int dy) {
 void resetGame() {
     generateMaze();
     placeTreasures(5 + rand() % 6); // Place 5-10 treasures
+    solveMaze();
+    if (show_hint) {
+        markHintPath(player, true);
+    }
     moves = 0;
     game_won = false;
 }
 
 // Main function
-int main() {
+int main(int argc, char *argv[]) {
     // Initialize random seed
     srand((unsigned int)time(NULL));
     
+    // Command line options
+    bool benchmark = false;
+    bool benchmark_solver = false;
+    bool benchmark_render = false;
+    bool benchmark_input = false;
+    bool memory_report = false;
+    bool size_given = false;
+    int width = DEFAULT_WIDTH, height = DEFAULT_HEIGHT;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            // Maze size in characters, e.g. 101x51
+            i++;
+            if (sscanf(argv[i], "%dx%d", &width, &height) != 2 ||
+                width < 5 || height < 5) {
+                printf("Ignoring --size %s, expected WIDTHxHEIGHT of at least 5x5\n", argv[i]);
+                width = DEFAULT_WIDTH;
+                height = DEFAULT_HEIGHT;
+            } else {
+                size_given = true;
+            }
+        } else if (strcmp(argv[i], "--algorithm") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "eller") == 0) {
+                maze_algorithm = MAZE_ELLER;
+            } else if (strcmp(argv[i], "backtracker") == 0) {
+                maze_algorithm = MAZE_BACKTRACKER;
+            } else {
+                printf("Unknown algorithm %s, expected backtracker or eller\n", argv[i]);
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            srand((unsigned int)strtoul(argv[++i], NULL, 10));
+        } else if (strcmp(argv[i], "--bench-maze") == 0) {
+            benchmark = true;
+        } else if (strcmp(argv[i], "--bench-solve") == 0) {
+            benchmark_solver = true;
+        } else if (strcmp(argv[i], "--bench-render") == 0) {
+            benchmark_render = true;
+        } else if (strcmp(argv[i], "--maze-memory") == 0) {
+            memory_report = true;
+        } else if (strcmp(argv[i], "--bench-input") == 0) {
+            benchmark_input = true;
+        } else if (strcmp(argv[i], "--frame-stats") == 0) {
+            show_frame_stats = true;
+        }
+    }
+    
+    // The benchmark runs on a huge maze unless told otherwise
+    if ((benchmark || benchmark_solver) && !size_given) {
+        width = 10001;
+        height = 10001;
+    }
+    if (memory_report && !size_given) {
+        width = 50001;
+        height = 50001;
+    }
+    if (!allocMaze(width, height)) {
+        return 1;
+    }
+    if (benchmark || benchmark_solver || benchmark_render || benchmark_input || memory_report) {
+        if (memory_report) {
+            reportMazeMemory();
+        }
+        if (benchmark_render) {
+            benchmarkRender();
+        }
+        if (benchmark_input) {
+            benchmarkInput();
+        }
+        if (benchmark) {
+            benchmarkMaze();
+        }
+        if (benchmark_solver) {
+            benchmarkSolver();
+        }
+        freeSolver();
+        freeMaze();
+        return 0;
+    }
+    
     // Terminal setup
     initTerminal();
+    int cols, rows;
+    getTerminalSize(&cols, &rows);
+    if (!screenInit(STDOUT_FILENO, cols, rows)) {
+        resetTerminal();
+        return 1;
+    }
     
     // Initialize the game
     resetGame();
     
     // Game loop
-    bool running = true;
-    char input;
-    
-    while (running) {
-        // Render the maze
-        renderMaze();
-        
-        // Get input
-        #ifdef _WIN32
-        if (_kbhit()) {
-            input = getch();
-            
-            // Handle arrow keys in Windows (arrow keys return two bytes)
-            if (input == 0 || input == 224) {
-                input = getch();
-                switch (input) {
-                    case 72: input = KEY_UP; break;    // Up arrow
-                    case 80: input = KEY_DOWN; break;  // Down arrow
-                    case 75: input = KEY_LEFT; break;  // Left arrow
-                    case 77: input = KEY_RIGHT; break; // Right arrow
-                }
-            }
-            
-            // Handle quit
-            if (input == KEY_QUIT) {
-                running = false;
-            } else {
-                handleInput(input);
-            }
-        }
-        #else
-        // Unix/Mac input handling
-        input = getch();
-        
-        // Handle arrow keys in Unix (arrow keys return escape sequence)
-        if (input == 27) {
-            // Skip the '['
-            getch();
-            input = getch();
-            switch (input) {
-                case 'A': input = KEY_UP; break;    // Up arrow
-                case 'B': input = KEY_DOWN; break;  // Down arrow
-                case 'D': input = KEY_LEFT; break;  // Left arrow
-                case 'C': input = KEY_RIGHT; break; // Right arrow
-            }
-        }
-        
-        // Handle quit
-        if (input == KEY_QUIT) {
-            running = false;
-        } else {
-            handleInput(input);
-        }
-        #endif
-        
-        // Delay for a bit
-        #ifdef _WIN32
-        Sleep(100);
-        #else
-        usleep(100000);
-        #endif
+    renderMaze();
+    while (gameStep(-1)) {
     }
     
     // Reset terminal settings
+    screenShutdown();
     resetTerminal();
+    if (show_frame_stats) {
+        printf("%d frames, %.0f bytes and %.2f writes per frame\n", screen.frames,
+               screen.frames ? (double)screen.total_bytes / screen.frames : 0.0,
+               screen.frames ? (double)screen.total_writes / screen.frames : 0.0);
+        printf("Key-to-screen latency: avg %.3f ms, max %.3f ms over %d keys\n",
+               latency.count ? latency.total / latency.count : 0.0, latency.max, latency.count);
+    }
+    freeSolver();
+    freeMaze();
     
     return 0;
 }